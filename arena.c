@@ -0,0 +1,168 @@
+#include "arena.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+bool init_arena(struct arena* arena, uint64_t size, enum placement_algo algo) {
+    if (algo == BUDDY || algo > TLSF || size == 0)
+        return false;
+    arena->page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+    arena->size = get_aligned_size(size, arena->page_size);
+    void* base = mmap(NULL, arena->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+        return false;
+    arena->base = (char*)base;
+    arena->algo = algo;
+    pthread_mutex_init(&arena->mutex, NULL);
+    // Blocks keep their header 64 byte aligned and always leave room for a payload behind it
+    struct block_layout layout;
+    init_block_layout(&layout, ARENA_HEADER_SIZE, 2 * ARENA_HEADER_SIZE);
+    init_memory(&arena->mem, arena->size, 0, &layout, arena->base);
+    return true;
+}
+
+struct partition* allocate_in_arena(struct arena* arena, uint64_t block_size) {
+    switch (arena->algo) {
+        case FIRST_FIT:
+            return first_fit(&arena->mem, block_size);
+        case BEST_FIT:
+            return best_fit(&arena->mem, block_size);
+        case NEXT_FIT:
+            return roving_next_fit(&arena->mem, block_size);
+        case WORST_FIT:
+            return worst_fit(&arena->mem, block_size);
+        case TLSF:
+            return tlsf_fit(&arena->mem, block_size);
+        case BUDDY:
+        case BITMAP_FIRST_FIT:
+        case BITMAP_BEST_FIT:
+        case BITMAP_NEXT_FIT:
+        case TABLE_FIRST_FIT:
+        case TABLE_BEST_FIT:
+        case TABLE_NEXT_FIT:
+        case TABLE_WORST_FIT:
+            break;
+    }
+    return NULL;
+}
+
+void* arena_alloc(struct arena* arena, size_t size) {
+    if (size > arena->size)
+        return NULL;
+    pthread_mutex_lock(&arena->mutex);
+    struct partition* part = allocate_in_arena(arena, ARENA_HEADER_SIZE + size);
+    pthread_mutex_unlock(&arena->mutex);
+    return part == NULL ? NULL : (char*)part + ARENA_HEADER_SIZE;
+}
+
+void* arena_alloc_aligned(struct arena* arena, size_t alignment, size_t size) {
+    if (alignment <= ARENA_HEADER_SIZE)
+        return arena_alloc(arena, size);
+    if (alignment > arena->size || size > arena->size)
+        return NULL;
+    char* payload = (char*)arena_alloc(arena, size + alignment);
+    if (payload == NULL)
+        return NULL;
+    uintptr_t aligned = ((uintptr_t)payload + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (aligned == (uintptr_t)payload)
+        return payload;
+    // Both addresses are multiples of the header size, so a whole header fits in the gap
+    struct partition* redirect = (struct partition*)(aligned - ARENA_HEADER_SIZE);
+    redirect->prev = (struct partition*)(payload - ARENA_HEADER_SIZE);
+    redirect->is_free = false;
+    redirect->mem = NULL;
+    return (void*)aligned;
+}
+
+struct partition* get_arena_partition(void* ptr) {
+    struct partition* part = (struct partition*)((char*)ptr - ARENA_HEADER_SIZE);
+    return part->mem == NULL ? part->prev : part;
+}
+
+size_t get_arena_usable_size(void* ptr) {
+    struct partition* part = get_arena_partition(ptr);
+    return (size_t)((char*)part + part->size - (char*)ptr);
+}
+
+bool is_in_arena(struct arena* arena, void* ptr) {
+    return (char*)ptr >= arena->base && (char*)ptr < arena->base + arena->size;
+}
+
+/*
+Drops the pages of a free partition that lie wholly inside it and overlap [start, end), they read back as zeros once touched again
+*/
+void trim_arena_partition(struct arena* arena, struct partition* part, char* start, char* end) {
+    uintptr_t page_mask = ~(uintptr_t)(arena->page_size - 1);
+    uintptr_t first = (uintptr_t)part + ARENA_HEADER_SIZE;
+    uintptr_t last = (uintptr_t)part + part->size;
+    if ((uintptr_t)start > first)
+        first = (uintptr_t)start;
+    if ((uintptr_t)end < last)
+        last = (uintptr_t)end;
+    first = (first + arena->page_size - 1) & page_mask;
+    last &= page_mask;
+    if (last > first)
+        madvise((void*)first, last - first, MADV_DONTNEED);
+}
+
+void arena_free(struct arena* arena, void* ptr) {
+    if (ptr == NULL)
+        return;
+    struct partition* part = get_arena_partition(ptr);
+    pthread_mutex_lock(&arena->mutex);
+    // Free runs past the threshold were trimmed already, the block and any smaller free neighbour are left
+    struct partition* first = part->prev != NULL && part->prev->is_free && part->prev->size < ARENA_TRIM_THRESHOLD ? part->prev : part;
+    struct partition* last = part->next != NULL && part->next->is_free && part->next->size < ARENA_TRIM_THRESHOLD ? part->next : part;
+    char* start = (char*)first - arena->page_size;
+    char* end = (char*)last + last->size + arena->page_size;
+    struct partition* survivor = part->prev != NULL && part->prev->is_free ? part->prev : part;
+    deallocate_partition(part);
+    if (survivor->size >= ARENA_TRIM_THRESHOLD)
+        trim_arena_partition(arena, survivor, start, end);
+    pthread_mutex_unlock(&arena->mutex);
+}
+
+void* arena_realloc(struct arena* arena, void* ptr, size_t size) {
+    if (ptr == NULL)
+        return arena_alloc(arena, size);
+    if (size > arena->size)
+        return NULL;
+    struct partition* part = get_arena_partition(ptr);
+    uint64_t offset = (uint64_t)((char*)ptr - (char*)part);
+    pthread_mutex_lock(&arena->mutex);
+    struct partition* resized = resize_partition(&arena->mem, part, offset + size);
+    pthread_mutex_unlock(&arena->mutex);
+    if (resized != NULL)
+        return ptr;
+    void* moved = arena_alloc(arena, size);
+    if (moved == NULL)
+        return NULL;
+    size_t usable_size = get_arena_usable_size(ptr);
+    memcpy(moved, ptr, usable_size < size ? usable_size : size);
+    arena_free(arena, ptr);
+    return moved;
+}
+
+bool parse_arena_algo(const char* name, enum placement_algo* algo) {
+    if (strcmp(name, "first") == 0) {
+        *algo = FIRST_FIT;
+    } else if (strcmp(name, "best") == 0) {
+        *algo = BEST_FIT;
+    } else if (strcmp(name, "next") == 0) {
+        *algo = NEXT_FIT;
+    } else if (strcmp(name, "worst") == 0) {
+        *algo = WORST_FIT;
+    } else if (strcmp(name, "tlsf") == 0) {
+        *algo = TLSF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void free_arena(struct arena* arena) {
+    pthread_mutex_destroy(&arena->mutex);
+    munmap(arena->base, arena->size);
+}
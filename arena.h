@@ -0,0 +1,82 @@
+#ifndef CS303_ARENA_H
+#define CS303_ARENA_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ds.h"
+#include "simulator.h"
+
+#define ARENA_HEADER_SIZE (sizeof(struct partition))  // Every block starts with its partition header
+#define ARENA_MIN_ALIGNMENT (16)                      // Alignment malloc() guarantees
+#define DEFAULT_ARENA_SIZE (4ULL << 30)               // Reserved address space, pages are only backed once touched
+#define ARENA_TRIM_THRESHOLD (256 * 1024)             // Free runs this large return the pages of freed blocks to the OS
+
+_Static_assert(ARENA_HEADER_SIZE % ARENA_MIN_ALIGNMENT == 0, "payloads must stay aligned after the header");
+
+/*
+Partition allocator serving real memory out of one mmap'd region
+The partition headers are the boundary tags of the blocks: each sits inline in front of its payload and links
+the neighbouring blocks, so a pointer is freed by stepping back one header
+Every block carries ARENA_HEADER_SIZE (64) bytes of header and spans at least twice that, so a 1 byte malloc() takes 128 bytes
+First fit visits every free block large enough, so it takes time linear in the number of free holes, best and worst fit
+search a tree of the free blocks and TLSF takes constant time
+`mutex` guards `mem`
+*/
+struct arena {
+    struct memory mem;
+    enum placement_algo algo;  // One of the partition list algorithms, FIRST_FIT to TLSF but BUDDY
+    pthread_mutex_t mutex;
+    char* base;
+    uint64_t size;
+    uint64_t page_size;
+};
+
+/*
+Maps `size` bytes rounded to whole pages and serves them with `algo`
+Returns false if `algo` does not work on a partition list or the mapping fails
+*/
+bool init_arena(struct arena* arena, uint64_t size, enum placement_algo algo);
+
+/*
+Returns NULL if no free block holds `size` bytes
+*/
+void* arena_alloc(struct arena* arena, size_t size);
+
+/*
+`alignment` must be a power of two
+*/
+void* arena_alloc_aligned(struct arena* arena, size_t alignment, size_t size);
+
+/*
+Grows in place when the block or its free successor holds `size` bytes, otherwise moves the payload
+*/
+void* arena_realloc(struct arena* arena, void* ptr, size_t size);
+
+void arena_free(struct arena* arena, void* ptr);
+
+bool is_in_arena(struct arena* arena, void* ptr);
+
+/*
+Header of the block holding `ptr`, over-aligned pointers are preceded by a header that only points to it
+*/
+struct partition* get_arena_partition(void* ptr);
+
+/*
+Bytes that can be written at `ptr`, at least the size it was allocated with
+*/
+size_t get_arena_usable_size(void* ptr);
+
+/*
+Returns false if `name` is not one of first, best, next, worst, or tlsf
+*/
+bool parse_arena_algo(const char* name, enum placement_algo* algo);
+
+/*
+Unmaps the arena, every pointer it served becomes invalid
+*/
+void free_arena(struct arena* arena);
+
+#endif
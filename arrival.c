@@ -0,0 +1,104 @@
+#include "arrival.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rng.h"
+
+void init_arrival_model(struct arrival_model* model, enum arrival_distribution distribution, double mean_batch_size, double peak_factor, double mean_dwell_in_millis) {
+    model->distribution = distribution;
+    model->mean_batch_size = mean_batch_size;
+    model->peak_factor = peak_factor;
+    model->mean_dwell_in_millis = mean_dwell_in_millis;
+}
+
+struct arrival_model* get_new_arrival_model(enum arrival_distribution distribution, double mean_batch_size, double peak_factor, double mean_dwell_in_millis) {
+    struct arrival_model* model = (struct arrival_model*)malloc(sizeof(struct arrival_model));
+    init_arrival_model(model, distribution, mean_batch_size, peak_factor, mean_dwell_in_millis);
+    return model;
+}
+
+bool parse_arrival_model(const char* spec, struct arrival_model* model) {
+    if (strcmp(spec, "poisson") == 0) {
+        model->distribution = ARRIVALS_POISSON;
+        return true;
+    }
+    if (strcmp(spec, "mmpp") == 0) {
+        model->distribution = ARRIVALS_MMPP;
+        model->peak_factor = DEFAULT_MMPP_PEAK_FACTOR;
+        return true;
+    }
+    double value;
+    if (sscanf(spec, "bursty:%lf", &value) == 1 && value >= 1) {
+        model->distribution = ARRIVALS_BURSTY;
+        model->mean_batch_size = value;
+        return true;
+    }
+    if (sscanf(spec, "mmpp:%lf", &value) == 1 && value >= 1 && value <= 2) {
+        model->distribution = ARRIVALS_MMPP;
+        model->peak_factor = value;
+        return true;
+    }
+    return false;
+}
+
+void init_arrival_generator(struct arrival_generator* arrivals, struct arrival_model* model, double r) {
+    if (model != NULL)
+        arrivals->model = *model;
+    else
+        init_arrival_model(&arrivals->model, ARRIVALS_POISSON, 1, DEFAULT_MMPP_PEAK_FACTOR, DEFAULT_MMPP_DWELL_IN_MILLIS);
+    arrivals->r = r;
+    arrivals->now_in_millis = 0;
+    arrivals->is_busy = false;
+    arrivals->state_end_in_millis = 0;
+}
+
+/*
+Geometric on {1, 2, ...} with the given mean
+*/
+int get_batch_size(struct rng* rng, double mean_batch_size) {
+    if (mean_batch_size <= 1) return 1;
+    double u = 1.0 - get_rng_uniform(rng);
+    return 1 + (int)floor(log(u) / log(1.0 - 1.0 / mean_batch_size));
+}
+
+/*
+Time of the next MMPP arrival, the state switches after exponentially distributed dwell times
+Inter-arrival times are memoryless, so an arrival that would fall after a switch is redrawn from the switch
+*/
+double next_mmpp_arrival(struct arrival_generator* arrivals, struct rng* rng) {
+    double now = arrivals->now_in_millis;
+    while (true) {
+        if (now >= arrivals->state_end_in_millis) {
+            arrivals->is_busy = !arrivals->is_busy;
+            arrivals->state_end_in_millis = now + get_rng_exponential(rng, 1.0 / arrivals->model.mean_dwell_in_millis);
+        }
+        double factor = arrivals->is_busy ? arrivals->model.peak_factor : 2.0 - arrivals->model.peak_factor;
+        double rate_per_milli = arrivals->r * factor / 1000;
+        double next = rate_per_milli > 0 ? now + get_rng_exponential(rng, rate_per_milli) : INFINITY;
+        if (next < arrivals->state_end_in_millis) return next;
+        now = arrivals->state_end_in_millis;
+    }
+}
+
+int next_arrival_batch(struct arrival_generator* arrivals, struct rng* rng, double* time_in_millis) {
+    if (arrivals->r <= 0) return 0;
+    int batch_size = 1;
+    switch (arrivals->model.distribution) {
+        case ARRIVALS_BURSTY:
+            arrivals->now_in_millis += get_rng_exponential(rng, arrivals->r / arrivals->model.mean_batch_size / 1000);
+            batch_size = get_batch_size(rng, arrivals->model.mean_batch_size);
+            break;
+        case ARRIVALS_MMPP:
+            arrivals->now_in_millis = next_mmpp_arrival(arrivals, rng);
+            break;
+        default:
+            arrivals->now_in_millis += get_rng_exponential(rng, arrivals->r / 1000);
+            break;
+    }
+    *time_in_millis = arrivals->now_in_millis;
+    return batch_size;
+}
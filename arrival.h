@@ -0,0 +1,57 @@
+#ifndef CS303_ARRIVAL_H
+#define CS303_ARRIVAL_H
+
+#include <stdbool.h>
+
+#include "rng.h"
+
+#define DEFAULT_MMPP_PEAK_FACTOR (1.8)       // Rate of the busy state over the mean rate
+#define DEFAULT_MMPP_DWELL_IN_MILLIS (5000)  // Mean time spent in a state before switching
+
+enum arrival_distribution {
+    ARRIVALS_POISSON = 0,  // Exponential inter-arrival times
+    ARRIVALS_BURSTY = 1,   // Poisson batches of simultaneous arrivals, geometric batch sizes of mean `mean_batch_size`
+    ARRIVALS_MMPP = 2      // Markov-modulated Poisson, alternating between a busy and a quiet rate
+};
+
+/*
+Shape of the arrival stream, the mean rate is given separately so every shape can run at the same load
+*/
+struct arrival_model {
+    enum arrival_distribution distribution;
+    double mean_batch_size;
+    double peak_factor;  // Busy rate over mean rate, in [1, 2], the quiet rate is the mirror image
+    double mean_dwell_in_millis;
+};
+
+void init_arrival_model(struct arrival_model* model, enum arrival_distribution distribution, double mean_batch_size, double peak_factor, double mean_dwell_in_millis);
+
+struct arrival_model* get_new_arrival_model(enum arrival_distribution distribution, double mean_batch_size, double peak_factor, double mean_dwell_in_millis);
+
+/*
+Parses "poisson", "bursty:<mean batch size>", "mmpp" or "mmpp:<peak factor>" into `model`
+Returns false if `spec` is not valid
+*/
+bool parse_arrival_model(const char* spec, struct arrival_model* model);
+
+struct arrival_generator {
+    struct arrival_model model;
+    double r;              // Mean arrivals per second
+    double now_in_millis;  // Time of the last batch
+    bool is_busy;          // MMPP state
+    double state_end_in_millis;
+};
+
+/*
+Starts a stream of `r` arrivals per second at time 0, `model` may be NULL for Poisson arrivals
+*/
+void init_arrival_generator(struct arrival_generator* arrivals, struct arrival_model* model, double r);
+
+/*
+Draws the next batch of simultaneous arrivals from `rng` and stores its time since the start in `time_in_millis`
+Returns the number of arrivals in the batch
+        0 if the rate is not positive, there are no more arrivals
+*/
+int next_arrival_batch(struct arrival_generator* arrivals, struct rng* rng, double* time_in_millis);
+
+#endif
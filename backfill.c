@@ -0,0 +1,84 @@
+#include "backfill.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "ds.h"
+
+struct backfill_scheduler* get_new_backfill_scheduler(enum backfill_policy policy, int limit) {
+    struct backfill_scheduler* scheduler = (struct backfill_scheduler*)malloc(sizeof(struct backfill_scheduler));
+    scheduler->policy = policy;
+    scheduler->limit = limit;
+    scheduler->head_bypasses = 0;
+    for (int i = 0; i < NUM_SIZE_CLASSES; i++)
+        scheduler->queued_by_size_class[i] = 0;
+    scheduler->queued_size_classes = 0;
+    scheduler->indexed = 0;
+    scheduler->dequeued = 0;
+    return scheduler;
+}
+
+bool fits_in_memory(struct memory* mem, uint64_t size) {
+    return get_largest_free_partition_size(mem) >= get_block_size(mem, size);
+}
+
+void index_queued_process(struct backfill_scheduler* scheduler, struct process* proc) {
+    int size_class = get_size_class(proc->s);
+    scheduler->queued_by_size_class[size_class] += 1;
+    scheduler->queued_size_classes |= 1ULL << size_class;
+}
+
+void unindex_queued_process(struct backfill_scheduler* scheduler, struct process* proc) {
+    int size_class = get_size_class(proc->s);
+    scheduler->queued_by_size_class[size_class] -= 1;
+    if (scheduler->queued_by_size_class[size_class] == 0)
+        scheduler->queued_size_classes &= ~(1ULL << size_class);
+}
+
+/*
+Indexes the processes enqueued since the last call
+*/
+void index_new_processes(struct backfill_scheduler* scheduler, struct process_queue* queue) {
+    int size = get_queue_size(queue);
+    for (int offset = scheduler->indexed - scheduler->dequeued; offset < size; offset++) {
+        index_queued_process(scheduler, peek_queue_at(queue, offset));
+        scheduler->indexed += 1;
+    }
+}
+
+int find_backfill_process(struct backfill_scheduler* scheduler, struct process_queue* queue, struct memory* mem) {
+    index_new_processes(scheduler, queue);
+    struct process* head = peek_queue(queue);
+    if (head == NULL) return -1;
+    if (fits_in_memory(mem, head->s)) return 0;
+    if (scheduler->head_bypasses >= scheduler->limit) return -1;  // Reserved for the head
+
+    uint64_t largest_free_size = get_largest_free_partition_size(mem);
+    if (scheduler->queued_size_classes == 0 || (1ULL << __builtin_ctzll(scheduler->queued_size_classes)) > largest_free_size)
+        return -1;  // Even the smallest queued process does not fit
+
+    int fit = -1;
+    int size = get_queue_size(queue);
+    for (int offset = 1; offset < size; offset++) {
+        uint64_t process_size = peek_queue_at(queue, offset)->s;
+        if (!fits_in_memory(mem, process_size)) continue;
+        if (scheduler->policy == BACKFILL_FIRST) return offset;
+        if (fit == -1 || process_size > peek_queue_at(queue, fit)->s)
+            fit = offset;
+    }
+    return fit;
+}
+
+struct process* take_backfill_process(struct backfill_scheduler* scheduler, struct process_queue* queue, int offset) {
+    index_new_processes(scheduler, queue);
+    struct process* proc = dequeue_at(queue, offset);
+    if (proc == NULL) return NULL;
+    unindex_queued_process(scheduler, proc);
+    scheduler->dequeued += 1;
+    scheduler->head_bypasses = offset == 0 ? 0 : scheduler->head_bypasses + 1;
+    return proc;
+}
+
+void free_backfill_scheduler(struct backfill_scheduler* scheduler) {
+    free(scheduler);
+}
@@ -0,0 +1,52 @@
+#ifndef CS303_BACKFILL_H
+#define CS303_BACKFILL_H
+
+#include <stdbool.h>
+
+#include "ds.h"
+
+#define DEFAULT_BACKFILL_LIMIT (10)
+
+enum backfill_policy {
+    BACKFILL_FIRST = 0,  // Earliest queued process that fits
+    BACKFILL_BEST = 1    // Largest queued process that fits
+};
+
+/*
+Consumer side scheduler that lets queued processes overtake a head that does not fit
+Queued processes are indexed by size class as the consumer first sees them, so a scan is skipped when even the smallest one can not fit
+Otherwise the scan is linear in the number of queued processes, which the maximum queue size bounds
+Once the head has been overtaken `limit` times, memory is reserved for it and nothing overtakes it until it is allocated
+Every dequeue of the queue must go through take_backfill_process()
+*/
+struct backfill_scheduler {
+    enum backfill_policy policy;
+    int limit;
+    int head_bypasses;  // Times the current head has been overtaken
+    int queued_by_size_class[NUM_SIZE_CLASSES];
+    uint64_t queued_size_classes;  // Bit i is set iff some indexed process is in size class i
+    long indexed;                  // Number of processes indexed so far, dequeued ones included
+    long dequeued;
+};
+
+struct backfill_scheduler* get_new_backfill_scheduler(enum backfill_policy policy, int limit);
+
+/*
+Whether the block of a process of `size` bytes fits in the largest free partition of `mem`
+*/
+bool fits_in_memory(struct memory* mem, uint64_t size);
+
+/*
+Offset behind the queue head of the process to allocate next
+        -1 if no queued process fits or the head holds the reservation
+*/
+int find_backfill_process(struct backfill_scheduler* scheduler, struct process_queue* queue, struct memory* mem);
+
+/*
+Dequeues the process at `offset`, once it has been allocated
+*/
+struct process* take_backfill_process(struct backfill_scheduler* scheduler, struct process_queue* queue, int offset);
+
+void free_backfill_scheduler(struct backfill_scheduler* scheduler);
+
+#endif
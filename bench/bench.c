@@ -0,0 +1,307 @@
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../bitmap.h"
+#include "../buddy.h"
+#include "../ds.h"
+#include "../logger.h"
+#include "../simulator.h"
+#include "../table.h"
+
+#define MIN_PARTITION_SIZE (1)
+#define MAX_PARTITION_SIZE (32)
+#define MEMORY_PER_LIVE_PARTITION (2 * MAX_PARTITION_SIZE)  // Keeps utilization around 25%, every algorithm reaches steady state
+#define DEFAULT_MAX_LIVE_PARTITIONS (1000000)
+#define DEFAULT_OPS (200000)
+#define DEFAULT_BUDGET_IN_MILLIS (2000)  // Per scenario, slow scenarios stop early
+#define MIN_OPS (1000)
+#define DEFAULT_TOLERANCE (25)  // Percentage of slowdown in ns/op reported as a regression
+#define BENCH_SEED (303)
+
+struct fit {
+    const char* name;
+    enum placement_algo algo;
+    struct partition* (*run)(struct memory* mem, uint64_t size);
+};
+
+struct fit fits[] = {
+    {"first_fit", FIRST_FIT, first_fit},
+    {"best_fit", BEST_FIT, best_fit},
+    {"next_fit", NEXT_FIT, roving_next_fit},
+    {"buddy_fit", BUDDY, buddy_fit},
+    {"worst_fit", WORST_FIT, worst_fit},
+    {"tlsf_fit", TLSF, tlsf_fit},
+    {"bitmap_first_fit", BITMAP_FIRST_FIT, bitmap_first_fit},
+    {"bitmap_best_fit", BITMAP_BEST_FIT, bitmap_best_fit},
+    {"bitmap_next_fit", BITMAP_NEXT_FIT, bitmap_next_fit},
+    {"table_first_fit", TABLE_FIRST_FIT, table_first_fit},
+    {"table_best_fit", TABLE_BEST_FIT, table_best_fit},
+    {"table_next_fit", TABLE_NEXT_FIT, table_next_fit},
+    {"table_worst_fit", TABLE_WORST_FIT, table_worst_fit}};
+
+struct result {
+    char name[32];
+    int live_partitions;
+    char op[32];
+    long ops;
+    double ns_per_op;
+    double ops_per_sec;
+    long p50;
+    long p99;
+    long p999;
+    long failures;
+};
+
+struct results {
+    struct result* items;
+    int size;
+    int capacity;
+};
+
+long budget_in_nanos = DEFAULT_BUDGET_IN_MILLIS * 1000000L;
+
+long get_time_in_nanos() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+int compare_longs(const void* a, const void* b) {
+    long x = *(const long*)a;
+    long y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+void add_result(struct results* results, struct result* result) {
+    if (results->size == results->capacity) {
+        results->capacity = results->capacity == 0 ? 64 : 2 * results->capacity;
+        results->items = (struct result*)realloc(results->items, results->capacity * sizeof(struct result));
+    }
+    results->items[results->size++] = *result;
+}
+
+/*
+Sorts `latencies` in place and summarizes them
+*/
+void summarize(struct result* result, const char* name, int live_partitions, const char* op, long* latencies, long ops, long total_in_nanos, long failures) {
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    snprintf(result->op, sizeof(result->op), "%s", op);
+    result->live_partitions = live_partitions;
+    result->ops = ops;
+    result->failures = failures;
+    result->ns_per_op = ops == 0 ? 0 : (double)total_in_nanos / ops;
+    result->ops_per_sec = total_in_nanos == 0 ? 0 : ops * 1e9 / total_in_nanos;
+    qsort(latencies, ops, sizeof(long), compare_longs);
+    result->p50 = ops == 0 ? 0 : latencies[ops * 50 / 100];
+    result->p99 = ops == 0 ? 0 : latencies[ops * 99 / 100];
+    result->p999 = ops == 0 ? 0 : latencies[ops * 999 / 1000];
+}
+
+/*
+Fills a memory with `live_partitions` partitions, then replaces a random live partition `ops` times, or until the time budget runs out
+Every replacement is one deallocate_partition() and one allocation through `fit`, timed separately
+*/
+void bench_fit(struct fit* fit, int live_partitions, long ops, struct results* results) {
+    unsigned int seed = BENCH_SEED;
+    int p = live_partitions * MEMORY_PER_LIVE_PARTITION;
+    struct block_layout layout;  // Byte granular, so the numbers stay comparable with the baseline
+    init_block_layout(&layout, 1, 1);
+    struct memory* mem = get_new_memory_for_algo(p + 1, 1, fit->algo, &layout);
+    struct partition** live = (struct partition**)malloc(live_partitions * sizeof(struct partition*));
+    for (int i = 0; i < live_partitions; i++)
+        live[i] = fit->run(mem, MIN_PARTITION_SIZE + rand_r(&seed) % MAX_PARTITION_SIZE);
+
+    long* alloc_latencies = (long*)malloc(ops * sizeof(long));
+    long* free_latencies = (long*)malloc(ops * sizeof(long));
+    long alloc_total = 0, free_total = 0, failures = 0;
+    long i;
+    for (i = 0; i < ops && (i < MIN_OPS || alloc_total + free_total < budget_in_nanos); i++) {
+        int slot = rand_r(&seed) % live_partitions;
+        int size = MIN_PARTITION_SIZE + rand_r(&seed) % MAX_PARTITION_SIZE;
+
+        long start = get_time_in_nanos();
+        if (live[slot] != NULL)
+            deallocate_partition(live[slot]);
+        long middle = get_time_in_nanos();
+        live[slot] = fit->run(mem, size);
+        long end = get_time_in_nanos();
+
+        free_latencies[i] = middle - start;
+        alloc_latencies[i] = end - middle;
+        free_total += middle - start;
+        alloc_total += end - middle;
+        failures += live[slot] == NULL;
+    }
+
+    struct result result;
+    summarize(&result, fit->name, live_partitions, "allocate", alloc_latencies, i, alloc_total, failures);
+    add_result(results, &result);
+    summarize(&result, fit->name, live_partitions, "deallocate_partition", free_latencies, i, free_total, 0);
+    add_result(results, &result);
+
+    free(alloc_latencies);
+    free(free_latencies);
+    free(live);
+    free_memory(mem);
+}
+
+/*
+Splits the only free partition of a fresh memory and frees it again, no placement decision involved
+*/
+void bench_allocate_partition(int live_partitions, long ops, struct results* results) {
+    unsigned int seed = BENCH_SEED;
+    struct memory* mem = get_new_empty_memory(live_partitions * MEMORY_PER_LIVE_PARTITION + 1, 1);
+    for (int i = 0; i < live_partitions - 1; i++)
+        allocate_partition(mem, mem->largest_free_partition, MIN_PARTITION_SIZE + rand_r(&seed) % MAX_PARTITION_SIZE);
+
+    long* alloc_latencies = (long*)malloc(ops * sizeof(long));
+    long* free_latencies = (long*)malloc(ops * sizeof(long));
+    long alloc_total = 0, free_total = 0, failures = 0;
+    long i;
+    for (i = 0; i < ops && (i < MIN_OPS || alloc_total + free_total < budget_in_nanos); i++) {
+        int size = MIN_PARTITION_SIZE + rand_r(&seed) % MAX_PARTITION_SIZE;
+        long start = get_time_in_nanos();
+        struct partition* part = allocate_partition(mem, mem->largest_free_partition, size);
+        long middle = get_time_in_nanos();
+        if (part != NULL)
+            deallocate_partition(part);
+        long end = get_time_in_nanos();
+
+        alloc_latencies[i] = middle - start;
+        free_latencies[i] = end - middle;
+        alloc_total += middle - start;
+        free_total += end - middle;
+        failures += part == NULL;
+    }
+
+    struct result result;
+    summarize(&result, "allocate_partition", live_partitions, "allocate", alloc_latencies, i, alloc_total, failures);
+    add_result(results, &result);
+    summarize(&result, "allocate_partition", live_partitions, "deallocate_partition", free_latencies, i, free_total, 0);
+    add_result(results, &result);
+
+    free(alloc_latencies);
+    free(free_latencies);
+    free_memory(mem);
+}
+
+void print_result(struct result* result) {
+    printf("%-20s %9d %-22s %10.1f %14.0f %8ld %8ld %8ld %8ld\n", result->name, result->live_partitions, result->op, result->ns_per_op, result->ops_per_sec, result->p50, result->p99, result->p999, result->failures);
+}
+
+void write_results(struct results* results, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        log_error("Could not write results to %s", path);
+        return;
+    }
+    fprintf(file, "name,live_partitions,op,ops,ns_per_op,ops_per_sec,p50_ns,p99_ns,p999_ns,failures\n");
+    for (int i = 0; i < results->size; i++) {
+        struct result* r = &results->items[i];
+        fprintf(file, "%s,%d,%s,%ld,%.2f,%.0f,%ld,%ld,%ld,%ld\n", r->name, r->live_partitions, r->op, r->ops, r->ns_per_op, r->ops_per_sec, r->p50, r->p99, r->p999, r->failures);
+    }
+    fclose(file);
+}
+
+/*
+Returns the number of regressions, -1 if there is no baseline at `path`
+*/
+int compare_with_baseline(struct results* results, const char* path, int tolerance) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return -1;
+    char line[512];
+    int regressions = 0;
+    printf("\n%-20s %9s %-22s %10s %10s %8s\n", "name", "live", "op", "baseline", "now", "change");
+    fgets(line, sizeof(line), file);  // Header
+    while (fgets(line, sizeof(line), file) != NULL) {
+        struct result baseline;
+        if (sscanf(line, "%31[^,],%d,%31[^,],%ld,%lf", baseline.name, &baseline.live_partitions, baseline.op, &baseline.ops, &baseline.ns_per_op) != 5) continue;
+        for (int i = 0; i < results->size; i++) {
+            struct result* r = &results->items[i];
+            if (strcmp(r->name, baseline.name) != 0 || r->live_partitions != baseline.live_partitions || strcmp(r->op, baseline.op) != 0) continue;
+            double change = baseline.ns_per_op == 0 ? 0 : 100.0 * (r->ns_per_op - baseline.ns_per_op) / baseline.ns_per_op;
+            bool is_regression = change > tolerance;
+            regressions += is_regression;
+            printf("%-20s %9d %-22s %10.1f %10.1f %+7.1f%%%s\n", r->name, r->live_partitions, r->op, baseline.ns_per_op, r->ns_per_op, change, is_regression ? "  REGRESSION" : "");
+        }
+    }
+    fclose(file);
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    const char* output_path = NULL;
+    const char* baseline_path = NULL;
+    int max_live_partitions = DEFAULT_MAX_LIVE_PARTITIONS;
+    long ops = DEFAULT_OPS;
+    int tolerance = DEFAULT_TOLERANCE;
+
+    struct option long_options[] = {
+        {"output", required_argument, NULL, 'o'},
+        {"baseline", required_argument, NULL, 'b'},
+        {"max-live", required_argument, NULL, 'n'},
+        {"ops", required_argument, NULL, 'k'},
+        {"tolerance", required_argument, NULL, 't'},
+        {"budget-ms", required_argument, NULL, 'm'},
+        {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "o:b:n:k:t:m:", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'o':
+                output_path = optarg;
+                break;
+            case 'b':
+                baseline_path = optarg;
+                break;
+            case 'n':
+                max_live_partitions = atoi(optarg);
+                break;
+            case 'k':
+                ops = atol(optarg);
+                break;
+            case 't':
+                tolerance = atoi(optarg);
+                break;
+            case 'm':
+                budget_in_nanos = atol(optarg) * 1000000L;
+                break;
+            default:
+                return 1;
+        }
+    }
+    if (max_live_partitions < 10 || ops <= 0) {
+        log_error("Live partitions should be at least 10 and ops positive, got %d and %ld", max_live_partitions, ops);
+        return 1;
+    }
+    mute_logs();
+
+    struct results results = {NULL, 0, 0};
+    printf("%-20s %9s %-22s %10s %14s %8s %8s %8s %8s\n", "name", "live", "op", "ns/op", "ops/sec", "p50", "p99", "p999", "failures");
+    for (long live_partitions = 10; live_partitions <= max_live_partitions; live_partitions *= 10) {
+        for (int i = 0; i < (int)(sizeof(fits) / sizeof(fits[0])); i++) {
+            bench_fit(&fits[i], live_partitions, ops, &results);
+            print_result(&results.items[results.size - 2]);
+            print_result(&results.items[results.size - 1]);
+        }
+        bench_allocate_partition(live_partitions, ops, &results);
+        print_result(&results.items[results.size - 2]);
+        print_result(&results.items[results.size - 1]);
+        fflush(stdout);
+    }
+
+    if (output_path != NULL)
+        write_results(&results, output_path);
+    int regressions = baseline_path == NULL ? -1 : compare_with_baseline(&results, baseline_path, tolerance);
+    free(results.items);
+    if (baseline_path != NULL && regressions < 0)
+        printf("\nNo baseline at %s, run `make bench-baseline` to store one\n", baseline_path);
+    if (regressions > 0) {
+        printf("\n%d regressions slower than the baseline by more than %d%%\n", regressions, tolerance);
+        return 1;
+    }
+    return 0;
+}
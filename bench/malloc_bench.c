@@ -0,0 +1,155 @@
+/*
+Throughput and resident memory of whichever malloc() the process is linked against
+Run it as is for the system allocator and with LD_PRELOAD=build/libcs303malloc.so for the arena, see `make bench-malloc`
+*/
+#include <getopt.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_THREADS (4)
+#define DEFAULT_OPS (200000)  // Per thread
+#define DEFAULT_LIVE (10000)  // Per thread
+#define SMALL_MAX_SIZE (512)
+#define MEDIUM_MAX_SIZE (64 * 1024)   // 1 in 32 allocations
+#define LARGE_MAX_SIZE (1024 * 1024)  // 1 in 1024 allocations
+#define BENCH_SEED (303)
+
+struct worker {
+    pthread_t thread;
+    uint64_t seed;
+    long ops;
+    int live;
+    long failures;
+};
+
+uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+size_t get_random_size(uint64_t* state) {
+    uint64_t r = next_random(state);
+    if (r % 1024 == 0)
+        return 1 + (r >> 10) % LARGE_MAX_SIZE;
+    if (r % 32 == 0)
+        return 1 + (r >> 10) % MEDIUM_MAX_SIZE;
+    return 1 + (r >> 10) % SMALL_MAX_SIZE;
+}
+
+/*
+Replaces a random live allocation per op, touching both ends of every new block
+*/
+void* run_worker(void* arg) {
+    struct worker* worker = (struct worker*)arg;
+    uint64_t state = worker->seed;
+    char** slots = (char**)calloc(worker->live, sizeof(char*));
+    for (long i = 0; i < worker->ops; i++) {
+        int slot = (int)(next_random(&state) % worker->live);
+        free(slots[slot]);
+        size_t size = get_random_size(&state);
+        slots[slot] = (char*)malloc(size);
+        if (slots[slot] == NULL) {
+            worker->failures += 1;
+            continue;
+        }
+        slots[slot][0] = (char)i;
+        slots[slot][size - 1] = (char)i;
+    }
+    for (int i = 0; i < worker->live; i++)
+        free(slots[i]);
+    free(slots);
+    return NULL;
+}
+
+double get_rss_in_mb() {
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file == NULL) return 0;
+    long pages = 0, resident = 0;
+    if (fscanf(file, "%ld %ld", &pages, &resident) != 2)
+        resident = 0;
+    fclose(file);
+    return (double)resident * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+}
+
+double get_max_rss_in_mb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+int main(int argc, char** argv) {
+    const char* label = "system";
+    int num_threads = DEFAULT_THREADS;
+    long ops = DEFAULT_OPS;
+    int live = DEFAULT_LIVE;
+    bool print_header = false;
+
+    struct option long_options[] = {
+        {"label", required_argument, NULL, 'l'},
+        {"threads", required_argument, NULL, 'j'},
+        {"ops", required_argument, NULL, 'k'},
+        {"live", required_argument, NULL, 'n'},
+        {"header", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "l:j:k:n:h", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'l':
+                label = optarg;
+                break;
+            case 'j':
+                num_threads = atoi(optarg);
+                break;
+            case 'k':
+                ops = atol(optarg);
+                break;
+            case 'n':
+                live = atoi(optarg);
+                break;
+            case 'h':
+                print_header = true;
+                break;
+            default:
+                return 1;
+        }
+    }
+    if (num_threads <= 0 || ops <= 0 || live <= 0) {
+        fprintf(stderr, "Threads, ops and live allocations should be positive, got %d, %ld and %d\n", num_threads, ops, live);
+        return 1;
+    }
+
+    struct worker* workers = (struct worker*)calloc(num_threads, sizeof(struct worker));
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_threads; i++) {
+        workers[i].seed = BENCH_SEED + 7919 * (i + 1);
+        workers[i].ops = ops;
+        workers[i].live = live;
+        pthread_create(&workers[i].thread, NULL, run_worker, &workers[i]);
+    }
+    long failures = 0;
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        failures += workers[i].failures;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(workers);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    long total_ops = ops * num_threads;
+    if (print_header)
+        printf("%-12s %8s %12s %10s %14s %12s %12s %9s\n", "allocator", "threads", "ops", "ns/op", "ops/sec", "max_rss_mb", "end_rss_mb", "failures");
+    printf("%-12s %8d %12ld %10.1f %14.0f %12.1f %12.1f %9ld\n", label, num_threads, total_ops, 1e9 * seconds / total_ops, total_ops / seconds, get_max_rss_in_mb(), get_rss_in_mb(), failures);
+    return failures > 0;
+}
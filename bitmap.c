@@ -0,0 +1,406 @@
+#include "bitmap.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "ds.h"
+#include "logger.h"
+
+#define BITS_PER_WORD (64)
+
+struct memory* get_new_bitmap_memory(uint64_t p, uint64_t q) {
+    struct block_layout layout;
+    init_block_layout(&layout, 1, 1);
+    return get_new_bitmap_memory_with_layout(p, q, &layout);
+}
+
+struct memory* get_new_bitmap_memory_with_layout(uint64_t p, uint64_t q, struct block_layout* layout) {
+    struct memory* mem = get_new_memory_with_layout(p, q, layout);
+    struct bitmap_allocator* bitmap = (struct bitmap_allocator*)malloc(sizeof(struct bitmap_allocator));
+    bitmap->unit_size = get_block_size(mem, 0);
+    bitmap->num_units = (mem->p - mem->q) / bitmap->unit_size;
+    bitmap->num_words = bitmap->num_units / BITS_PER_WORD + 1;
+    bitmap->words = (uint64_t*)calloc(bitmap->num_words, sizeof(uint64_t));
+    bitmap->words[bitmap->num_words - 1] = ~0ULL << (bitmap->num_units % BITS_PER_WORD);
+    bitmap->cursor = 0;
+    bitmap->largest_free_units = bitmap->num_units;
+    bitmap->is_largest_known = true;
+    bitmap->scan = get_supported_bitmap_scan();
+    mem->bitmap = bitmap;
+
+    // Free space only lives in the bitmap
+    remove_free_partition(mem, mem->head);
+    free_partition(mem, mem->head);
+    mem->head = NULL;
+    mem->q = mem->p - bitmap->num_units * bitmap->unit_size;
+    mem->free_size = bitmap->num_units * bitmap->unit_size;
+    mem->free_partitions = bitmap->num_units > 0 ? 1 : 0;
+    return mem;
+}
+
+enum bitmap_scan get_supported_bitmap_scan() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2"))
+        return BITMAP_SCAN_AVX2;
+    return BITMAP_SCAN_SSE2;
+#else
+    return BITMAP_SCAN_SCALAR;
+#endif
+}
+
+uint64_t skip_bitmap_words_scalar(const uint64_t* words, uint64_t from, uint64_t to, uint64_t pattern) {
+    while (from < to && words[from] == pattern)
+        from++;
+    return from;
+}
+
+#if defined(__x86_64__)
+uint64_t skip_bitmap_words_sse2(const uint64_t* words, uint64_t from, uint64_t to, uint64_t pattern) {
+    __m128i expected = _mm_set1_epi64x((long long)pattern);
+    // Equal 32-bit halves mean equal words, SSE2 has no 64-bit compare
+    while (from + 2 <= to && _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(words + from)), expected)) == 0xFFFF)
+        from += 2;
+    return skip_bitmap_words_scalar(words, from, to, pattern);
+}
+
+__attribute__((target("avx2"))) uint64_t skip_bitmap_words_avx2(const uint64_t* words, uint64_t from, uint64_t to, uint64_t pattern) {
+    __m256i expected = _mm256_set1_epi64x((long long)pattern);
+    while (from + 8 <= to) {
+        __m256i low = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(words + from)), expected);
+        __m256i high = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(words + from + 4)), expected);
+        if (_mm256_movemask_epi8(_mm256_and_si256(low, high)) != -1)
+            break;
+        from += 8;
+    }
+    while (from + 4 <= to && _mm256_movemask_epi8(_mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(words + from)), expected)) == -1)
+        from += 4;
+    return skip_bitmap_words_scalar(words, from, to, pattern);
+}
+#endif
+
+uint64_t skip_bitmap_words(enum bitmap_scan scan, const uint64_t* words, uint64_t from, uint64_t to, uint64_t pattern) {
+#if defined(__x86_64__)
+    switch (scan) {
+        case BITMAP_SCAN_AVX2:
+            if (__builtin_cpu_supports("avx2"))
+                return skip_bitmap_words_avx2(words, from, to, pattern);
+            return skip_bitmap_words_sse2(words, from, to, pattern);
+        case BITMAP_SCAN_SSE2:
+            return skip_bitmap_words_sse2(words, from, to, pattern);
+        case BITMAP_SCAN_SCALAR:
+            break;
+    }
+#endif
+    return skip_bitmap_words_scalar(words, from, to, pattern);
+}
+
+int get_bitmap_run_steps(uint64_t units, uint64_t* steps) {
+    int num_steps = 0;
+    for (uint64_t run = 1; run < units; run += steps[num_steps++])
+        steps[num_steps] = run < units - run ? run : units - run;
+    return num_steps;
+}
+
+/*
+Bit i is set iff bits i to i + units - 1 of `free` are all set, where `steps` come from get_bitmap_run_steps()
+*/
+uint64_t get_bitmap_run_starts(uint64_t free, const uint64_t* steps, int num_steps) {
+    for (int i = 0; i < num_steps; i++)
+        free &= free >> steps[i];
+    return free;
+}
+
+uint64_t skip_words_without_run_scalar(const uint64_t* words, uint64_t from, uint64_t to, const uint64_t* steps, int num_steps) {
+    for (; from < to; from++) {
+        uint64_t next = from + 1 < to ? words[from + 1] : ~0ULL;
+        uint64_t window = (words[from] >> 32) | (next << 32);
+        if ((get_bitmap_run_starts(~words[from], steps, num_steps) | get_bitmap_run_starts(~window, steps, num_steps)) != 0)
+            break;
+    }
+    return from;
+}
+
+#if defined(__x86_64__)
+uint64_t skip_words_without_run_sse2(const uint64_t* words, uint64_t from, uint64_t to, const uint64_t* steps, int num_steps) {
+    __m128i ones = _mm_set1_epi64x(-1);
+    while (from + 3 <= to) {
+        __m128i used = _mm_loadu_si128((const __m128i*)(words + from));
+        __m128i next = _mm_loadu_si128((const __m128i*)(words + from + 1));
+        __m128i starts = _mm_xor_si128(used, ones);
+        __m128i window = _mm_xor_si128(_mm_or_si128(_mm_srli_epi64(used, 32), _mm_slli_epi64(next, 32)), ones);
+        for (int i = 0; i < num_steps; i++) {
+            __m128i count = _mm_cvtsi64_si128((long long)steps[i]);
+            starts = _mm_and_si128(starts, _mm_srl_epi64(starts, count));
+            window = _mm_and_si128(window, _mm_srl_epi64(window, count));
+        }
+        __m128i any = _mm_or_si128(starts, window);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(any, _mm_setzero_si128())) != 0xFFFF)
+            break;
+        from += 2;
+    }
+    return skip_words_without_run_scalar(words, from, to, steps, num_steps);
+}
+
+__attribute__((target("avx2"))) uint64_t skip_words_without_run_avx2(const uint64_t* words, uint64_t from, uint64_t to, const uint64_t* steps, int num_steps) {
+    __m256i ones = _mm256_set1_epi64x(-1);
+    while (from + 5 <= to) {
+        __m256i used = _mm256_loadu_si256((const __m256i*)(words + from));
+        __m256i next = _mm256_loadu_si256((const __m256i*)(words + from + 1));
+        __m256i starts = _mm256_xor_si256(used, ones);
+        __m256i window = _mm256_xor_si256(_mm256_or_si256(_mm256_srli_epi64(used, 32), _mm256_slli_epi64(next, 32)), ones);
+        for (int i = 0; i < num_steps; i++) {
+            __m128i count = _mm_cvtsi64_si128((long long)steps[i]);
+            starts = _mm256_and_si256(starts, _mm256_srl_epi64(starts, count));
+            window = _mm256_and_si256(window, _mm256_srl_epi64(window, count));
+        }
+        __m256i any = _mm256_or_si256(starts, window);
+        if (!_mm256_testz_si256(any, any))
+            break;
+        from += 4;
+    }
+    return skip_words_without_run_scalar(words, from, to, steps, num_steps);
+}
+#endif
+
+uint64_t skip_bitmap_words_without_run(enum bitmap_scan scan, const uint64_t* words, uint64_t from, uint64_t to, uint64_t units) {
+    uint64_t steps[8];
+    int num_steps = get_bitmap_run_steps(units, steps);
+#if defined(__x86_64__)
+    switch (scan) {
+        case BITMAP_SCAN_AVX2:
+            if (__builtin_cpu_supports("avx2"))
+                return skip_words_without_run_avx2(words, from, to, steps, num_steps);
+            return skip_words_without_run_sse2(words, from, to, steps, num_steps);
+        case BITMAP_SCAN_SSE2:
+            return skip_words_without_run_sse2(words, from, to, steps, num_steps);
+        case BITMAP_SCAN_SCALAR:
+            break;
+    }
+#endif
+    return skip_words_without_run_scalar(words, from, to, steps, num_steps);
+}
+
+uint64_t find_next_bitmap_unit(struct bitmap_allocator* bitmap, uint64_t from, bool is_allocated) {
+    if (from >= bitmap->num_units)
+        return bitmap->num_units;
+    uint64_t skipped = is_allocated ? 0 : ~0ULL;  // Words without a single unit of the wanted kind
+    uint64_t index = from / BITS_PER_WORD;
+    uint64_t word = (bitmap->words[index] ^ skipped) & (~0ULL << (from % BITS_PER_WORD));
+    if (word == 0) {
+        index = skip_bitmap_words(bitmap->scan, bitmap->words, index + 1, bitmap->num_words, skipped);
+        if (index == bitmap->num_words)
+            return bitmap->num_units;
+        word = bitmap->words[index] ^ skipped;
+    }
+    uint64_t unit = index * BITS_PER_WORD + __builtin_ctzll(word);
+    return unit < bitmap->num_units ? unit : bitmap->num_units;
+}
+
+bool find_free_bitmap_run(struct bitmap_allocator* bitmap, uint64_t from, uint64_t* start, uint64_t* length) {
+    *start = find_next_bitmap_unit(bitmap, from, false);
+    if (*start == bitmap->num_units)
+        return false;
+    *length = find_next_bitmap_unit(bitmap, *start, true) - *start;
+    return true;
+}
+
+bool is_bitmap_unit_allocated(struct bitmap_allocator* bitmap, uint64_t unit) {
+    return (bitmap->words[unit / BITS_PER_WORD] >> (unit % BITS_PER_WORD)) & 1;
+}
+
+void set_bitmap_units(struct bitmap_allocator* bitmap, uint64_t start, uint64_t count, bool is_allocated) {
+    uint64_t end = start + count;
+    while (start < end) {
+        uint64_t offset = start % BITS_PER_WORD;
+        uint64_t bits = end - start < BITS_PER_WORD - offset ? end - start : BITS_PER_WORD - offset;
+        uint64_t mask = (bits == BITS_PER_WORD ? ~0ULL : (1ULL << bits) - 1) << offset;
+        if (is_allocated)
+            bitmap->words[start / BITS_PER_WORD] |= mask;
+        else
+            bitmap->words[start / BITS_PER_WORD] &= ~mask;
+        start += bits;
+    }
+}
+
+/*
+Units of the block of a process, 0 if it can never fit
+*/
+uint64_t get_bitmap_units(struct memory* mem, uint64_t process_size) {
+    struct bitmap_allocator* bitmap = mem->bitmap;
+    uint64_t block_size = get_block_size(mem, process_size);
+    if (block_size > bitmap->num_units * bitmap->unit_size)
+        return 0;
+    uint64_t units = (block_size + bitmap->unit_size - 1) / bitmap->unit_size;
+    if (bitmap->is_largest_known && units > bitmap->largest_free_units)
+        return 0;
+    return units;
+}
+
+/*
+Allocates `units` free units at `start`
+*/
+struct partition* allocate_bitmap_run(struct memory* mem, uint64_t start, uint64_t units, uint64_t process_size) {
+    struct bitmap_allocator* bitmap = mem->bitmap;
+    bool is_free_before = start > 0 && !is_bitmap_unit_allocated(bitmap, start - 1);
+    // The run is no longer than the longest one, it can only be as long if its last possible unit is free
+    uint64_t last = start + bitmap->largest_free_units - 1;
+    if (is_free_before || (bitmap->is_largest_known && last < bitmap->num_units && !is_bitmap_unit_allocated(bitmap, last)))
+        bitmap->is_largest_known = false;
+    set_bitmap_units(bitmap, start, units, true);
+    bool is_free_after = !is_bitmap_unit_allocated(bitmap, start + units);
+    if (is_free_before && is_free_after)
+        mem->free_partitions += 1;
+    else if (!is_free_before && !is_free_after)
+        mem->free_partitions -= 1;
+    uint64_t size = units * bitmap->unit_size;
+    mem->free_size -= size;
+    struct partition* part = get_new_memory_partition(mem, NULL, NULL, start * bitmap->unit_size, size, true);
+    mark_partition_allocated(mem, part, process_size);
+    return part;
+}
+
+uint64_t find_bitmap_run_at_least(struct bitmap_allocator* bitmap, uint64_t from, uint64_t to, uint64_t units) {
+    if (from >= bitmap->num_units)
+        return bitmap->num_units;
+    if (units > BITS_PER_WORD) {
+        uint64_t start, length;
+        for (; find_free_bitmap_run(bitmap, from, &start, &length) && start < to; from = start + length) {
+            if (length >= units)
+                return start;
+        }
+        return bitmap->num_units;
+    }
+    uint64_t index = from / BITS_PER_WORD;
+    uint64_t used = bitmap->words[index] | ((1ULL << (from % BITS_PER_WORD)) - 1);  // Units before `from` count as allocated
+    uint64_t carry = 0;  // Free units right before word `index`
+    uint64_t steps[8];
+    int num_steps = get_bitmap_run_steps(units, steps);
+    while (true) {
+        uint64_t base = index * BITS_PER_WORD;
+        if (base - carry >= to)
+            return bitmap->num_units;
+        uint64_t low_free = used == 0 ? BITS_PER_WORD : __builtin_ctzll(used);
+        if (carry > 0 && carry + low_free >= units)
+            return base - carry;
+        uint64_t starts = get_bitmap_run_starts(~used, steps, num_steps);
+        if (starts != 0) {
+            uint64_t start = base + __builtin_ctzll(starts);
+            return start < to ? start : bitmap->num_units;
+        }
+        carry = used == 0 ? carry + BITS_PER_WORD : (uint64_t)__builtin_clzll(used);
+        if (++index == bitmap->num_words)
+            return bitmap->num_units;
+        // Nothing reaches into the next word, so words that hold no run can be skipped several at a time
+        if (carry == 0 && units <= BITS_PER_WORD / 2) {
+            index = skip_bitmap_words_without_run(bitmap->scan, bitmap->words, index, bitmap->num_words, units);
+            if (index == bitmap->num_words)
+                return bitmap->num_units;
+        } else if (carry == 0 && bitmap->words[index] == ~0ULL) {
+            index = skip_bitmap_words(bitmap->scan, bitmap->words, index, bitmap->num_words, ~0ULL);
+            if (index == bitmap->num_words)
+                return bitmap->num_units;
+        }
+        used = bitmap->words[index];
+    }
+}
+
+struct partition* bitmap_first_fit(struct memory* mem, uint64_t process_size) {
+    struct bitmap_allocator* bitmap = mem->bitmap;
+    uint64_t units = get_bitmap_units(mem, process_size);
+    if (units == 0) return NULL;
+    uint64_t start = find_bitmap_run_at_least(bitmap, 0, bitmap->num_units, units);
+    if (start == bitmap->num_units) return NULL;
+    return allocate_bitmap_run(mem, start, units, process_size);
+}
+
+struct partition* bitmap_best_fit(struct memory* mem, uint64_t process_size) {
+    struct bitmap_allocator* bitmap = mem->bitmap;
+    uint64_t units = get_bitmap_units(mem, process_size);
+    if (units == 0) return NULL;
+    uint64_t best_start = 0, best_length = 0;
+    // Searching from the end of a run lands on the start of the next run that holds the process
+    for (uint64_t from = 0;;) {
+        uint64_t start = find_bitmap_run_at_least(bitmap, from, bitmap->num_units, units);
+        if (start == bitmap->num_units) break;
+        uint64_t length = find_next_bitmap_unit(bitmap, start, true) - start;
+        if (best_length == 0 || length < best_length) {
+            best_start = start;
+            best_length = length;
+            if (length == units) break;
+        }
+        from = start + length;
+    }
+    if (best_length == 0) return NULL;
+    return allocate_bitmap_run(mem, best_start, units, process_size);
+}
+
+struct partition* bitmap_next_fit(struct memory* mem, uint64_t process_size) {
+    struct bitmap_allocator* bitmap = mem->bitmap;
+    uint64_t units = get_bitmap_units(mem, process_size);
+    if (units == 0) return NULL;
+    uint64_t start = find_bitmap_run_at_least(bitmap, bitmap->cursor, bitmap->num_units, units);
+    // Wrap around, the run holding the cursor is whole again
+    if (start == bitmap->num_units)
+        start = find_bitmap_run_at_least(bitmap, 0, bitmap->cursor, units);
+    if (start == bitmap->num_units)
+        return NULL;
+    bitmap->cursor = start;
+    return allocate_bitmap_run(mem, start, units, process_size);
+}
+
+void deallocate_bitmap_partition(struct memory* mem, struct partition* part) {
+    struct bitmap_allocator* bitmap = mem->bitmap;
+    uint64_t start = part->address / bitmap->unit_size;
+    uint64_t units = part->size / bitmap->unit_size;
+    set_bitmap_units(bitmap, start, units, false);
+    bool is_free_before = start > 0 && !is_bitmap_unit_allocated(bitmap, start - 1);
+    bool is_free_after = !is_bitmap_unit_allocated(bitmap, start + units);  // The sentinel bits are allocated
+    if (is_free_before && is_free_after)
+        mem->free_partitions -= 1;
+    else if (!is_free_before && !is_free_after)
+        mem->free_partitions += 1;
+    if (is_free_before || is_free_after)
+        bitmap->is_largest_known = false;
+    else if (units > bitmap->largest_free_units)
+        bitmap->largest_free_units = units;
+    mem->free_size += part->size;
+    free_partition(mem, part);
+}
+
+uint64_t get_largest_free_bitmap_run_size(struct memory* mem) {
+    struct bitmap_allocator* bitmap = mem->bitmap;
+    if (!bitmap->is_largest_known) {
+        uint64_t start, length;
+        bitmap->largest_free_units = 0;
+        for (uint64_t from = 0; find_free_bitmap_run(bitmap, from, &start, &length); from = start + length) {
+            if (length > bitmap->largest_free_units)
+                bitmap->largest_free_units = length;
+        }
+        bitmap->is_largest_known = true;
+    }
+    return bitmap->largest_free_units * bitmap->unit_size;
+}
+
+void print_bitmap_memory(struct memory* mem) {
+    struct bitmap_allocator* bitmap = mem->bitmap;
+    uint64_t from = 0;
+    log_info("┌────────────┐");
+    while (from < bitmap->num_units) {
+        bool is_allocated = is_bitmap_unit_allocated(bitmap, from);
+        uint64_t to = find_next_bitmap_unit(bitmap, from, !is_allocated);
+        if (from > 0)
+            log_info("├────────────┤");
+        log_info("│ %s %8.1f │", is_allocated ? "✓" : " ", get_size_in_mb((to - from) * bitmap->unit_size));
+        from = to;
+    }
+    log_info("└────────────┘");
+}
+
+void free_bitmap_allocator(struct bitmap_allocator* bitmap) {
+    free(bitmap->words);
+    free(bitmap);
+}
@@ -0,0 +1,108 @@
+#ifndef CS303_BITMAP_H
+#define CS303_BITMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ds.h"
+
+enum bitmap_scan {
+    BITMAP_SCAN_SCALAR = 0,
+    BITMAP_SCAN_SSE2 = 1,  // 2 words per compare
+    BITMAP_SCAN_AVX2 = 2   // 4 words per compare
+};
+
+/*
+Fixed unit representation of a memory, there is no partition list and only allocated partitions exist
+The p - q bytes are split into units of the block size of the layout, bit i of `words` is set iff unit i is allocated
+Free runs are found by skipping whole words that are all ones or all zeros, `scan` picks how many words are compared at once
+*/
+struct bitmap_allocator {
+    uint64_t unit_size;
+    uint64_t num_units;
+    uint64_t num_words;  // Words covering the units plus a sentinel word, the bits past `num_units` are all set
+    uint64_t* words;
+    uint64_t cursor;                // Unit where the next bitmap_next_fit() resumes
+    uint64_t largest_free_units;    // Length of the longest free run, only valid if `is_largest_known`
+    bool is_largest_known;
+    enum bitmap_scan scan;
+};
+
+/*
+Memory whose p - q bytes are tracked one bit per unit
+Partitions of this memory must only be allocated by bitmap_first_fit(), bitmap_best_fit() or bitmap_next_fit()
+*/
+struct memory* get_new_bitmap_memory(uint64_t p, uint64_t q);
+
+/*
+Same as get_new_bitmap_memory() with units of the block size of `layout`, bytes past the last whole unit are reserved
+*/
+struct memory* get_new_bitmap_memory_with_layout(uint64_t p, uint64_t q, struct block_layout* layout);
+
+/*
+Widest scan the CPU supports
+*/
+enum bitmap_scan get_supported_bitmap_scan();
+
+/*
+Index of the first word in [from, to) that differs from `pattern`, `to` if there is none
+Scans the CPU does not support fall back to the scalar one
+*/
+uint64_t skip_bitmap_words(enum bitmap_scan scan, const uint64_t* words, uint64_t from, uint64_t to, uint64_t pattern);
+
+/*
+Index of the first word in [from, to) in which a run of at least `units` free units may start, `to` if there is none
+Only for runs of up to 32 units, a run crossing into the next word lies within the upper half of one word and the lower half
+of the next, so that window is checked along with the word itself
+*/
+uint64_t skip_bitmap_words_without_run(enum bitmap_scan scan, const uint64_t* words, uint64_t from, uint64_t to, uint64_t units);
+
+/*
+First unit at or after `from` that is allocated if `is_allocated`, free otherwise
+Returns `num_units` if there is none
+*/
+uint64_t find_next_bitmap_unit(struct bitmap_allocator* bitmap, uint64_t from, bool is_allocated);
+
+/*
+Longest run of free units that starts at or after `from`
+Returns false if there is no free unit past `from`
+*/
+bool find_free_bitmap_run(struct bitmap_allocator* bitmap, uint64_t from, uint64_t* start, uint64_t* length);
+
+/*
+First unit in [from, to) that starts a run of at least `units` free units, the run may reach past `to`
+Runs of up to 64 units are found a word at a time by shifting the free bits onto themselves
+Returns `num_units` if there is none
+*/
+uint64_t find_bitmap_run_at_least(struct bitmap_allocator* bitmap, uint64_t from, uint64_t to, uint64_t units);
+
+void set_bitmap_units(struct bitmap_allocator* bitmap, uint64_t start, uint64_t count, bool is_allocated);
+
+/*
+Lowest addressed free run that holds the process
+*/
+struct partition* bitmap_first_fit(struct memory* mem, uint64_t process_size);
+
+/*
+Shortest free run that holds the process, the lowest addressed of them on ties
+*/
+struct partition* bitmap_best_fit(struct memory* mem, uint64_t process_size);
+
+/*
+First fit resuming from `cursor`, wrapping around to the start once
+*/
+struct partition* bitmap_next_fit(struct memory* mem, uint64_t process_size);
+
+/*
+Clears the units of the freed partition and releases it
+Called by deallocate_partition() once `part` is marked free
+*/
+void deallocate_bitmap_partition(struct memory* mem, struct partition* part);
+
+uint64_t get_largest_free_bitmap_run_size(struct memory* mem);
+
+void print_bitmap_memory(struct memory* mem);
+
+void free_bitmap_allocator(struct bitmap_allocator* bitmap);
+
+#endif
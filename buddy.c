@@ -0,0 +1,130 @@
+#include "buddy.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "ds.h"
+
+#define BITS_PER_WORD (8 * sizeof(unsigned long))
+
+bool is_buddy_block_free(struct buddy_allocator* buddy, int order, uint64_t address) {
+    uint64_t index = address >> order;
+    if (index >= buddy->total_size >> order) return false;
+    return (buddy->free_bitmaps[order][index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1UL;
+}
+
+void set_buddy_block_free(struct buddy_allocator* buddy, int order, uint64_t address, bool is_free) {
+    uint64_t index = address >> order;
+    if (is_free)
+        buddy->free_bitmaps[order][index / BITS_PER_WORD] |= 1UL << (index % BITS_PER_WORD);
+    else
+        buddy->free_bitmaps[order][index / BITS_PER_WORD] &= ~(1UL << (index % BITS_PER_WORD));
+}
+
+void insert_buddy_block(struct memory* mem, struct partition* part) {
+    insert_free_partition(mem, part);
+    set_buddy_block_free(mem->buddy, get_size_class(part->size), part->address, true);
+}
+
+void remove_buddy_block(struct memory* mem, struct partition* part) {
+    remove_free_partition(mem, part);
+    set_buddy_block_free(mem->buddy, get_size_class(part->size), part->address, false);
+}
+
+/*
+Halves `part` and returns the upper half as a new partition
+*/
+struct partition* split_buddy_block(struct memory* mem, struct partition* part) {
+    part->size /= 2;
+    struct partition* upper = get_new_memory_partition(mem, part, part->next, part->address + part->size, part->size, true);
+    if (part->next != NULL)
+        part->next->prev = upper;
+    part->next = upper;
+    return upper;
+}
+
+int get_buddy_order(uint64_t size) {
+    int order = get_size_class(size);
+    return (1ULL << order) < size ? order + 1 : order;
+}
+
+struct memory* get_new_buddy_memory(uint64_t p, uint64_t q) {
+    struct block_layout layout;
+    init_block_layout(&layout, 1, 1);
+    return get_new_buddy_memory_with_layout(p, q, &layout);
+}
+
+struct memory* get_new_buddy_memory_with_layout(uint64_t p, uint64_t q, struct block_layout* layout) {
+    struct memory* mem = get_new_memory_with_layout(p, q, layout);
+    struct buddy_allocator* buddy = (struct buddy_allocator*)malloc(sizeof(struct buddy_allocator));
+    buddy->min_order = get_buddy_order(get_block_size(mem, 0));
+    buddy->total_size = (mem->p - mem->q) & ~((1ULL << buddy->min_order) - 1);
+    for (int order = 0; order < NUM_SIZE_CLASSES; order++) {
+        buddy->free_bitmaps[order] = NULL;
+        if (order < buddy->min_order) continue;
+        uint64_t blocks = buddy->total_size >> order;
+        buddy->free_bitmaps[order] = (unsigned long*)calloc(blocks / BITS_PER_WORD + 1, sizeof(unsigned long));
+    }
+    mem->buddy = buddy;
+
+    struct partition* part = mem->head;
+    remove_free_partition(mem, part);
+    mem->q = mem->p - buddy->total_size;
+    part->size = buddy->total_size;
+    if (buddy->total_size == 0)
+        return mem;  // Not even one block fits, the empty head is never handed out
+    while (part->size & (part->size - 1)) {
+        uint64_t block_size = 1ULL << get_size_class(part->size);
+        struct partition* rest = get_new_memory_partition(mem, part, part->next, part->address + block_size, part->size - block_size, true);
+        part->size = block_size;
+        part->next = rest;
+        insert_buddy_block(mem, part);
+        part = rest;
+    }
+    insert_buddy_block(mem, part);
+    return mem;
+}
+
+struct partition* buddy_fit(struct memory* mem, uint64_t process_size) {
+    int order = get_buddy_order(get_block_size(mem, process_size));
+    if (order < mem->buddy->min_order)
+        order = mem->buddy->min_order;
+    if (order >= NUM_SIZE_CLASSES) return NULL;
+    uint64_t orders = mem->size_class_bitmap & (~0ULL << order);
+    if (orders == 0) return NULL;
+    int block_order = __builtin_ctzll(orders);
+
+    struct partition* part = mem->free_lists[block_order][0];
+    remove_buddy_block(mem, part);
+    while (block_order > order) {
+        insert_buddy_block(mem, split_buddy_block(mem, part));
+        block_order--;
+    }
+    mark_partition_allocated(mem, part, process_size);
+    return part;
+}
+
+void deallocate_buddy_partition(struct memory* mem, struct partition* part) {
+    struct buddy_allocator* buddy = mem->buddy;
+    int order = get_size_class(part->size);
+    while (order + 1 < NUM_SIZE_CLASSES && is_buddy_block_free(buddy, order, part->address ^ (1ULL << order))) {
+        bool is_upper_half = part->address & (1ULL << order);
+        struct partition* lower = is_upper_half ? part->prev : part;
+        struct partition* upper = is_upper_half ? part : part->next;
+        remove_buddy_block(mem, is_upper_half ? lower : upper);
+        lower->size *= 2;
+        lower->next = upper->next;
+        if (upper->next != NULL)
+            upper->next->prev = lower;
+        release_merged_partition(mem, upper, lower);
+        part = lower;
+        order++;
+    }
+    insert_buddy_block(mem, part);
+}
+
+void free_buddy_allocator(struct buddy_allocator* buddy) {
+    for (int order = 0; order < NUM_SIZE_CLASSES; order++)
+        free(buddy->free_bitmaps[order]);
+    free(buddy);
+}
@@ -0,0 +1,46 @@
+#ifndef CS303_BUDDY_H
+#define CS303_BUDDY_H
+
+#include "ds.h"
+
+/*
+Buddy system over the partition list of a memory
+Free blocks of order k have 2^k bytes and sit in `mem->free_lists[k][0]`, the bitmaps tell in O(1) whether a buddy is free
+*/
+struct buddy_allocator {
+    uint64_t total_size;
+    int min_order;                                  // No block is smaller than the alignment and the minimum block size
+    unsigned long* free_bitmaps[NUM_SIZE_CLASSES];  // Bit i of order k is set iff block [i * 2^k, (i + 1) * 2^k) is free, NULL below `min_order`
+};
+
+/*
+Memory whose p - q bytes are carved into the largest naturally aligned power-of-two blocks
+Partitions of this memory must only be allocated by buddy_fit()
+*/
+struct memory* get_new_buddy_memory(uint64_t p, uint64_t q);
+
+/*
+Same as get_new_buddy_memory() with the granularity of `layout`, bytes past the last whole block of the smallest order are reserved
+If not even one block fits, the memory holds no block and every allocation fails
+*/
+struct memory* get_new_buddy_memory_with_layout(uint64_t p, uint64_t q, struct block_layout* layout);
+
+/*
+Smallest order whose block holds `size` bytes
+*/
+int get_buddy_order(uint64_t size);
+
+/*
+Allocates a 2^k bytes block for the process, splitting a larger free block if needed
+*/
+struct partition* buddy_fit(struct memory* mem, uint64_t process_size);
+
+/*
+Merges the freed block with its buddy for as long as the buddy is free
+Called by deallocate_partition() once `part` is marked free
+*/
+void deallocate_buddy_partition(struct memory* mem, struct partition* part);
+
+void free_buddy_allocator(struct buddy_allocator* buddy);
+
+#endif
@@ -0,0 +1,70 @@
+#include "compaction.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ds.h"
+#include "logger.h"
+
+struct compaction_policy* get_new_compaction_policy(enum compaction_trigger trigger, float fragmentation_threshold, long period_in_millis, int bandwidth) {
+    struct compaction_policy* policy = (struct compaction_policy*)malloc(sizeof(struct compaction_policy));
+    policy->trigger = trigger;
+    policy->fragmentation_threshold = fragmentation_threshold;
+    policy->period_in_millis = period_in_millis;
+    policy->bandwidth = bandwidth;
+    policy->last_compaction_in_millis = 0;
+    return policy;
+}
+
+bool parse_compaction_trigger(const char* spec, struct compaction_policy* policy) {
+    if (strcmp(spec, "none") == 0) {
+        policy->trigger = COMPACTION_DISABLED;
+        return true;
+    }
+    if (strcmp(spec, "failure") == 0) {
+        policy->trigger = COMPACTION_ON_FAILURE;
+        return true;
+    }
+    float threshold;
+    if (sscanf(spec, "fragmentation:%f", &threshold) == 1 && threshold >= 0 && threshold <= 100) {
+        policy->trigger = COMPACTION_ON_FRAGMENTATION;
+        policy->fragmentation_threshold = threshold;
+        return true;
+    }
+    long period;
+    if (sscanf(spec, "periodic:%ld", &period) == 1 && period > 0) {
+        policy->trigger = COMPACTION_PERIODIC;
+        policy->period_in_millis = period;
+        return true;
+    }
+    return false;
+}
+
+bool should_compact_after_failure(struct compaction_policy* policy, struct memory* mem, uint64_t process_size) {
+    return policy != NULL && policy->trigger == COMPACTION_ON_FAILURE && mem->buddy == NULL && mem->bitmap == NULL && mem->table == NULL && mem->base == NULL && mem->free_size >= get_block_size(mem, process_size);
+}
+
+bool should_compact(struct compaction_policy* policy, struct memory* mem, long now_in_millis) {
+    if (policy == NULL || mem->buddy != NULL || mem->bitmap != NULL || mem->table != NULL || mem->base != NULL || mem->free_partitions <= 1) return false;
+    switch (policy->trigger) {
+        case COMPACTION_ON_FRAGMENTATION:
+            return get_percentage_external_fragmentation(mem) > policy->fragmentation_threshold;
+        case COMPACTION_PERIODIC:
+            return now_in_millis - policy->last_compaction_in_millis >= policy->period_in_millis;
+        default:
+            return false;
+    }
+}
+
+long compact_and_record(struct compaction_policy* policy, struct memory* mem, struct stats* stat, long now_in_millis) {
+    uint64_t moved_size = compact_memory(mem);
+    long time_in_millis = policy->bandwidth > 0 ? (long)(1000.0 * get_size_in_mb(moved_size) / policy->bandwidth) : 0;
+    policy->last_compaction_in_millis = now_in_millis;
+    stat->compactions += 1;
+    stat->compaction_moved_size += moved_size;
+    stat->compaction_time_in_millis += time_in_millis;
+    log_warning("Memory compacted, %.2fMB relocated in %ldms", get_size_in_mb(moved_size), time_in_millis);
+    return time_in_millis;
+}
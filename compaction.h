@@ -0,0 +1,49 @@
+#ifndef CS303_COMPACTION_H
+#define CS303_COMPACTION_H
+
+#include <stdbool.h>
+
+#include "ds.h"
+
+#define DEFAULT_COMPACTION_BANDWIDTH (1000)  // MBs relocated per second
+
+enum compaction_trigger {
+    COMPACTION_DISABLED = 0,
+    COMPACTION_ON_FAILURE = 1,        // An allocation failed although the free memory would hold it
+    COMPACTION_ON_FRAGMENTATION = 2,  // External fragmentation exceeds `fragmentation_threshold`
+    COMPACTION_PERIODIC = 3           // Every `period_in_millis`
+};
+
+struct compaction_policy {
+    enum compaction_trigger trigger;
+    float fragmentation_threshold;  // Percentage, see get_percentage_external_fragmentation()
+    long period_in_millis;
+    int bandwidth;                  // MBs relocated per second, used to charge simulated time
+    long last_compaction_in_millis;
+};
+
+struct compaction_policy* get_new_compaction_policy(enum compaction_trigger trigger, float fragmentation_threshold, long period_in_millis, int bandwidth);
+
+/*
+Parses "failure", "fragmentation:<percentage>", "periodic:<millis>" or "none" into `policy`
+Returns false if `spec` is not valid
+*/
+bool parse_compaction_trigger(const char* spec, struct compaction_policy* policy);
+
+/*
+Whether a failed allocation of `process_size` bytes should compact and retry
+*/
+bool should_compact_after_failure(struct compaction_policy* policy, struct memory* mem, uint64_t process_size);
+
+/*
+Whether the fragmentation or periodic trigger fires at `now_in_millis`
+*/
+bool should_compact(struct compaction_policy* policy, struct memory* mem, long now_in_millis);
+
+/*
+Compacts `mem` and charges the relocation to `stat`
+Returns the simulated time the relocation takes in milliseconds
+*/
+long compact_and_record(struct compaction_policy* policy, struct memory* mem, struct stats* stat, long now_in_millis);
+
+#endif
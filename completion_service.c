@@ -0,0 +1,140 @@
+#include "completion_service.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ds.h"
+#include "heap.h"
+#include "logger.h"
+#include "pool.h"
+#include "shard.h"
+
+#define MAX_COMPLETION_BATCH_SIZE (64)
+
+long get_monotonic_time_in_millis() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000L + now.tv_nsec / 1000000;
+}
+
+struct timespec get_timespec_from_millis(long millis) {
+    struct timespec t;
+    t.tv_sec = millis / 1000;
+    t.tv_nsec = (millis % 1000) * 1000000;
+    return t;
+}
+
+void complete_sharded_batch(struct completion_service* service, struct completion** batch, int batch_size) {
+    for (int i = 0; i < batch_size; i++) {
+        struct process* proc = batch[i]->proc;
+        uint64_t size = batch[i]->part->size;
+        deallocate_from_shards(service->shards, batch[i]->part);
+        log_warning("%.2fMB partition freed from process (s: %.2fMB, d: %ds)", get_size_in_mb(size), get_size_in_mb(proc->s), proc->d);
+        free_process(proc);
+    }
+    notify_shard_frees(service->shards);
+}
+
+void complete_batch(struct completion_service* service, struct completion** batch, int batch_size) {
+    if (service->shards != NULL) {
+        complete_sharded_batch(service, batch, batch_size);
+        return;
+    }
+    pthread_mutex_lock(service->mem_mutex);
+    for (int i = 0; i < batch_size; i++) {
+        struct process* proc = batch[i]->proc;
+        uint64_t address = batch[i]->part->address;  // Read at completion, compaction may have moved the partition
+        uint64_t size = batch[i]->part->size;
+        deallocate_partition(batch[i]->part);
+        log_warning("%.2fMB partition [%lu, %lu] freed from process (s: %.2fMB, d: %ds)", get_size_in_mb(size), address, address + size, get_size_in_mb(proc->s), proc->d);
+        free_process(proc);
+    }
+    pthread_mutex_unlock(service->mem_mutex);
+    pthread_cond_broadcast(service->mem_available);
+}
+
+void* run_completion_service(void* args) {
+    struct completion_service* service = (struct completion_service*)args;
+    struct completion* batch[MAX_COMPLETION_BATCH_SIZE];
+    pthread_mutex_lock(&service->mutex);
+    while (!service->stopped) {
+        long deadline;
+        if (heap_peek(service->pending, &deadline) == NULL) {
+            pthread_cond_wait(&service->changed, &service->mutex);
+            continue;
+        }
+        if (deadline > get_monotonic_time_in_millis()) {
+            struct timespec timeout = get_timespec_from_millis(deadline);
+            pthread_cond_timedwait(&service->changed, &service->mutex, &timeout);
+            continue;
+        }
+        long now = get_monotonic_time_in_millis();
+        int batch_size = 0;
+        while (batch_size < MAX_COMPLETION_BATCH_SIZE && heap_peek(service->pending, &deadline) != NULL && deadline <= now)
+            batch[batch_size++] = (struct completion*)heap_pop(service->pending, NULL);
+        pthread_mutex_unlock(&service->mutex);
+
+        complete_batch(service, batch, batch_size);
+
+        pthread_mutex_lock(&service->mutex);
+        for (int i = 0; i < batch_size; i++)
+            pool_free(service->completion_pool, batch[i]);
+    }
+    pthread_mutex_unlock(&service->mutex);
+    return NULL;
+}
+
+struct completion_service* start_completion_service_over(pthread_mutex_t* mem_mutex, pthread_cond_t* mem_available, struct sharded_memory* shards) {
+    struct completion_service* service = (struct completion_service*)malloc(sizeof(struct completion_service));
+    service->pending = get_new_min_heap(OBJECTS_PER_POOL_CHUNK);
+    service->completion_pool = get_new_object_pool(sizeof(struct completion), OBJECTS_PER_POOL_CHUNK, false);
+    pthread_mutex_init(&service->mutex, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&service->changed, &attr);
+    pthread_condattr_destroy(&attr);
+    service->mem_mutex = mem_mutex;
+    service->mem_available = mem_available;
+    service->shards = shards;
+    service->stopped = false;
+    pthread_create(&service->thread, NULL, run_completion_service, service);
+    return service;
+}
+
+struct completion_service* start_completion_service(pthread_mutex_t* mem_mutex, pthread_cond_t* mem_available) {
+    return start_completion_service_over(mem_mutex, mem_available, NULL);
+}
+
+struct completion_service* start_sharded_completion_service(struct sharded_memory* shards) {
+    return start_completion_service_over(NULL, NULL, shards);
+}
+
+void schedule_completion(struct completion_service* service, struct process* proc, struct partition* part) {
+    long deadline = get_monotonic_time_in_millis() + proc->d * 1000L;
+    pthread_mutex_lock(&service->mutex);
+    struct completion* c = (struct completion*)pool_alloc(service->completion_pool);
+    c->proc = proc;
+    c->part = part;
+    long earliest_deadline;
+    bool is_earliest = heap_peek(service->pending, &earliest_deadline) == NULL || deadline < earliest_deadline;
+    heap_push(service->pending, deadline, c);
+    pthread_mutex_unlock(&service->mutex);
+    if (is_earliest)
+        pthread_cond_signal(&service->changed);
+}
+
+void stop_completion_service(struct completion_service* service) {
+    pthread_mutex_lock(&service->mutex);
+    service->stopped = true;
+    pthread_mutex_unlock(&service->mutex);
+    pthread_cond_signal(&service->changed);
+    pthread_join(service->thread, NULL);
+    free_min_heap(service->pending);
+    free_object_pool(service->completion_pool);
+    pthread_cond_destroy(&service->changed);
+    pthread_mutex_destroy(&service->mutex);
+    free(service);
+}
@@ -0,0 +1,47 @@
+#ifndef CS303_COMPLETION_SERVICE_H
+#define CS303_COMPLETION_SERVICE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "ds.h"
+#include "heap.h"
+#include "pool.h"
+#include "shard.h"
+
+struct completion {
+    struct process* proc;
+    struct partition* part;
+};
+
+/*
+Single timer thread that owns every running process
+Processes whose duration has elapsed are deallocated in batches under one acquisition of `mem_mutex`
+*/
+struct completion_service {
+    struct min_heap* pending;  // Completions keyed by deadline in milliseconds on CLOCK_MONOTONIC
+    struct object_pool* completion_pool;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    pthread_mutex_t* mem_mutex;
+    pthread_cond_t* mem_available;
+    struct sharded_memory* shards;  // If not NULL, partitions are freed under the locks of their shards instead of `mem_mutex`
+    pthread_t thread;
+    bool stopped;
+};
+
+struct completion_service* start_completion_service(pthread_mutex_t* mem_mutex, pthread_cond_t* mem_available);
+
+struct completion_service* start_sharded_completion_service(struct sharded_memory* shards);
+
+/*
+`part` is deallocated and `proc` freed once `proc->d` seconds have passed
+*/
+void schedule_completion(struct completion_service* service, struct process* proc, struct partition* part);
+
+/*
+Stops the timer thread, pending completions are dropped without being deallocated
+*/
+void stop_completion_service(struct completion_service* service);
+
+#endif
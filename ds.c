@@ -5,7 +5,10 @@
 #include <stdlib.h>
 #include <sys/time.h>
 
+#include "bitmap.h"
+#include "buddy.h"
 #include "logger.h"
+#include "table.h"
 
 struct stats* get_empty_stats() {
     struct stats* stat = (struct stats*)malloc(sizeof(struct stats));
@@ -13,294 +16,723 @@ struct stats* get_empty_stats() {
     stat->turnaround_time_den = 0;
     stat->memory_utilization_num = 0;
     stat->memory_utilization_den = 0;
+    stat->internal_fragmentation_num = 0;
+    stat->internal_fragmentation_den = 0;
+    stat->alignment_padding_num = 0;
+    stat->alignment_padding_den = 0;
+    stat->compactions = 0;
+    stat->compaction_moved_size = 0;
+    stat->compaction_time_in_millis = 0;
+    init_histogram(&stat->queue_wait_time);
+    init_histogram(&stat->turnaround_time);
+    atomic_init(&stat->dropped_arrivals, 0);
+    return stat;
 }
 
-struct process* get_new_process(int s, int d, struct timeval arrival_time) {
-    struct process* proc = (struct process*)malloc(sizeof(struct process));
+void init_process(struct process* proc, uint64_t s, int d, struct timeval arrival_time, struct object_pool* pool) {
     proc->s = s;
     proc->d = d;
     proc->arrival_time = arrival_time;
+    proc->pool = pool;
+}
+
+struct process* get_new_process(uint64_t s, int d, struct timeval arrival_time) {
+    struct process* proc = (struct process*)malloc(sizeof(struct process));
+    init_process(proc, s, d, arrival_time, NULL);
     return proc;
 }
 
-struct partition* get_new_partition(struct partition* prev, struct partition* next, int size, int is_free) {
-    struct partition* part = (struct partition*)malloc(sizeof(struct partition));
+struct process* get_new_queued_process(struct process_queue* queue, uint64_t s, int d, struct timeval arrival_time) {
+    struct process* proc = (struct process*)pool_alloc(queue->process_pool);
+    init_process(proc, s, d, arrival_time, queue->process_pool);
+    return proc;
+}
+
+double get_size_in_mb(uint64_t size) {
+    return (double)size / BYTES_PER_MB;
+}
+
+void init_partition(struct partition* part, struct partition* prev, struct partition* next, uint64_t size, int is_free) {
     part->prev = prev;
     part->next = next;
-    part->size = size;
+    part->address = 0;
+    part->tree_height = 0;
     part->is_free = is_free;
+    part->size = size;
+    part->prev_free = NULL;
+    part->next_free = NULL;
+    part->tree_left = NULL;
+    part->tree_right = NULL;
+    if (!is_free) {
+        part->requested_size = size;
+        part->mem = NULL;
+    }
+}
+
+struct partition* get_new_partition(struct partition* prev, struct partition* next, uint64_t size, int is_free) {
+    struct partition* part = (struct partition*)malloc(sizeof(struct partition));
+    init_partition(part, prev, next, size, is_free);
     return part;
 }
 
-struct memory* get_new_empty_memory(int p, int q) {
+struct partition* get_new_memory_partition(struct memory* mem, struct partition* prev, struct partition* next, uint64_t address, uint64_t size, int is_free) {
+    struct partition* part;
+    if (mem->base != NULL)
+        part = (struct partition*)(mem->base + address);
+    else
+        part = (struct partition*)pool_alloc(mem->partition_pool);
+    init_partition(part, prev, next, size, is_free);
+    if (!is_free)
+        part->mem = mem;
+    part->address = address;
+    return part;
+}
+
+int get_size_class(uint64_t size) {
+    if (size <= 1) return 0;
+    return 63 - __builtin_clzll(size);
+}
+
+int get_size_subclass(uint64_t size, int size_class) {
+    if (size <= 1) return 0;
+    uint64_t offset = size - (1ULL << size_class);
+    if (size_class >= NUM_SIZE_SUBCLASSES_LOG2)
+        return (int)(offset >> (size_class - NUM_SIZE_SUBCLASSES_LOG2));
+    return (int)((offset << NUM_SIZE_SUBCLASSES_LOG2) >> size_class);
+}
+
+uint64_t get_aligned_size(uint64_t size, uint64_t alignment) {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+uint64_t get_block_size(struct memory* mem, uint64_t size) {
+    if (mem == NULL) return size;
+    if (size < mem->layout.min_block_size)
+        size = mem->layout.min_block_size;
+    return get_aligned_size(size, mem->layout.alignment);
+}
+
+uint64_t get_alignment_padding(struct memory* mem, uint64_t size) {
+    if (mem == NULL) return 0;
+    return get_aligned_size(size, mem->layout.alignment) - size;
+}
+
+int get_tree_height(struct partition* node) {
+    return node == NULL ? 0 : node->tree_height;
+}
+
+void update_tree_height(struct partition* node) {
+    int left_height = get_tree_height(node->tree_left);
+    int right_height = get_tree_height(node->tree_right);
+    node->tree_height = 1 + (left_height > right_height ? left_height : right_height);
+}
+
+bool is_tree_key_less(struct partition* a, struct partition* b) {
+    return a->size < b->size || (a->size == b->size && a->address < b->address);
+}
+
+struct partition* rotate_tree_right(struct partition* node) {
+    struct partition* left = node->tree_left;
+    node->tree_left = left->tree_right;
+    left->tree_right = node;
+    update_tree_height(node);
+    update_tree_height(left);
+    return left;
+}
+
+struct partition* rotate_tree_left(struct partition* node) {
+    struct partition* right = node->tree_right;
+    node->tree_right = right->tree_left;
+    right->tree_left = node;
+    update_tree_height(node);
+    update_tree_height(right);
+    return right;
+}
+
+struct partition* rebalance_tree(struct partition* node) {
+    update_tree_height(node);
+    int balance = get_tree_height(node->tree_left) - get_tree_height(node->tree_right);
+    if (balance > 1) {
+        if (get_tree_height(node->tree_left->tree_left) < get_tree_height(node->tree_left->tree_right))
+            node->tree_left = rotate_tree_left(node->tree_left);
+        return rotate_tree_right(node);
+    }
+    if (balance < -1) {
+        if (get_tree_height(node->tree_right->tree_right) < get_tree_height(node->tree_right->tree_left))
+            node->tree_right = rotate_tree_right(node->tree_right);
+        return rotate_tree_left(node);
+    }
+    return node;
+}
+
+struct partition* insert_into_tree(struct partition* root, struct partition* part) {
+    if (root == NULL) {
+        part->tree_left = NULL;
+        part->tree_right = NULL;
+        part->tree_height = 1;
+        return part;
+    }
+    if (is_tree_key_less(part, root))
+        root->tree_left = insert_into_tree(root->tree_left, part);
+    else
+        root->tree_right = insert_into_tree(root->tree_right, part);
+    return rebalance_tree(root);
+}
+
+struct partition* remove_min_from_tree(struct partition* root, struct partition** min) {
+    if (root->tree_left == NULL) {
+        *min = root;
+        return root->tree_right;
+    }
+    root->tree_left = remove_min_from_tree(root->tree_left, min);
+    return rebalance_tree(root);
+}
+
+struct partition* remove_from_tree(struct partition* root, struct partition* part) {
+    if (root == NULL) return NULL;
+    if (root == part) {
+        if (root->tree_right == NULL) return root->tree_left;
+        struct partition* successor;
+        struct partition* right = remove_min_from_tree(root->tree_right, &successor);
+        successor->tree_left = root->tree_left;
+        successor->tree_right = right;
+        return rebalance_tree(successor);
+    }
+    if (is_tree_key_less(part, root))
+        root->tree_left = remove_from_tree(root->tree_left, part);
+    else
+        root->tree_right = remove_from_tree(root->tree_right, part);
+    return rebalance_tree(root);
+}
+
+struct partition* find_free_partition_at_least(struct memory* mem, uint64_t size) {
+    struct partition* node = mem->free_tree;
+    struct partition* fit = NULL;
+    while (node != NULL) {
+        if (node->size >= size) {
+            fit = node;
+            node = node->tree_left;
+        } else {
+            node = node->tree_right;
+        }
+    }
+    return fit;
+}
+
+void insert_free_partition(struct memory* mem, struct partition* part) {
+    if (mem == NULL) return;
+    int size_class = get_size_class(part->size);
+    int size_subclass = get_size_subclass(part->size, size_class);
+    part->prev_free = NULL;
+    part->next_free = mem->free_lists[size_class][size_subclass];
+    if (part->next_free != NULL)
+        part->next_free->prev_free = part;
+    mem->free_lists[size_class][size_subclass] = part;
+    mem->size_subclass_bitmaps[size_class] |= 1U << size_subclass;
+    mem->size_class_bitmap |= 1ULL << size_class;
+    mem->free_tree = insert_into_tree(mem->free_tree, part);
+    mem->free_size += part->size;
+    mem->free_partitions += 1;
+    if (mem->largest_free_partition == NULL || is_tree_key_less(mem->largest_free_partition, part))
+        mem->largest_free_partition = part;
+}
+
+void remove_free_partition(struct memory* mem, struct partition* part) {
+    if (mem == NULL) return;
+    if (part->prev_free != NULL) {
+        part->prev_free->next_free = part->next_free;
+    } else {
+        int size_class = get_size_class(part->size);
+        int size_subclass = get_size_subclass(part->size, size_class);
+        mem->free_lists[size_class][size_subclass] = part->next_free;
+        if (part->next_free == NULL) {
+            mem->size_subclass_bitmaps[size_class] &= ~(1U << size_subclass);
+            if (mem->size_subclass_bitmaps[size_class] == 0)
+                mem->size_class_bitmap &= ~(1ULL << size_class);
+        }
+    }
+    if (part->next_free != NULL)
+        part->next_free->prev_free = part->prev_free;
+    part->prev_free = NULL;
+    part->next_free = NULL;
+    mem->free_tree = remove_from_tree(mem->free_tree, part);
+    mem->free_size -= part->size;
+    mem->free_partitions -= 1;
+    if (mem->largest_free_partition == part) {
+        struct partition* largest = mem->free_tree;
+        while (largest != NULL && largest->tree_right != NULL)
+            largest = largest->tree_right;
+        mem->largest_free_partition = largest;
+    }
+}
+
+void init_block_layout(struct block_layout* layout, uint64_t alignment, uint64_t min_block_size) {
+    layout->alignment = alignment;
+    layout->min_block_size = min_block_size;
+}
+
+struct memory* get_new_empty_memory(uint64_t p, uint64_t q) {
+    struct block_layout layout;
+    init_block_layout(&layout, 1, 1);
+    return get_new_memory_with_layout(p, q, &layout);
+}
+
+struct memory* get_new_memory_with_layout(uint64_t p, uint64_t q, struct block_layout* layout) {
     struct memory* mem = (struct memory*)malloc(sizeof(struct memory));
-    mem->p = p;
-    mem->q = q;
-    mem->head = get_new_partition(NULL, NULL, p - q, true);
+    init_memory(mem, p, q, layout, NULL);
     return mem;
 }
 
-void compact(struct memory* mem) {
+void init_memory(struct memory* mem, uint64_t p, uint64_t q, struct block_layout* layout, char* base) {
+    mem->p = p;
+    mem->q = p - ((p - q) & ~(layout->alignment - 1));
+    mem->layout = *layout;
+    for (int i = 0; i < NUM_SIZE_CLASSES; i++) {
+        for (int j = 0; j < NUM_SIZE_SUBCLASSES; j++)
+            mem->free_lists[i][j] = NULL;
+        mem->size_subclass_bitmaps[i] = 0;
+    }
+    mem->size_class_bitmap = 0;
+    mem->free_tree = NULL;
+    mem->cursor = NULL;
+    mem->base = base;
+    mem->partition_pool = base == NULL ? get_new_object_pool(sizeof(struct partition), OBJECTS_PER_POOL_CHUNK, false) : NULL;
+    mem->used_size = 0;
+    mem->free_size = 0;
+    mem->free_partitions = 0;
+    mem->allocated_partitions = 0;
+    mem->largest_free_partition = NULL;
+    mem->requested_size = 0;
+    mem->padding_size = 0;
+    mem->buddy = NULL;
+    mem->bitmap = NULL;
+    mem->table = NULL;
+    mem->head = get_new_memory_partition(mem, NULL, NULL, 0, mem->p - mem->q, true);
+    insert_free_partition(mem, mem->head);
+}
+
+uint64_t compact_memory(struct memory* mem) {
+    if (mem->buddy != NULL || mem->bitmap != NULL || mem->table != NULL || mem->base != NULL || mem->free_size == 0) return 0;
+    uint64_t moved_size = 0;
+    uint64_t address = 0;
+    bool is_cursor_released = false;
+    struct partition* last = NULL;
     struct partition* part = mem->head;
     while (part != NULL) {
-        struct partition* next_part = part->next;
+        struct partition* next = part->next;
         if (part->is_free) {
-            while (next_part != NULL || next_part->is_free) {
-                part->size += next_part->size;
-                struct partition* part_to_free = next_part;
-                next_part = next_part->next;
-                free_partition(part_to_free);
-            }
-            part->next = next_part;
-            if (next_part != NULL) {
-                next_part->prev = part;
+            remove_free_partition(mem, part);
+            if (part->prev != NULL)
+                part->prev->next = next;
+            else
+                mem->head = next;
+            if (next != NULL)
+                next->prev = part->prev;
+            is_cursor_released = is_cursor_released || mem->cursor == part;
+            free_partition(mem, part);
+        } else {
+            if (part->address != address) {
+                part->address = address;
+                moved_size += part->size;
             }
+            address += part->size;
+            last = part;
         }
-        part = next_part;
+        part = next;
+    }
+    struct partition* hole = get_new_memory_partition(mem, last, NULL, address, mem->p - mem->q - address, true);
+    if (last != NULL)
+        last->next = hole;
+    else
+        mem->head = hole;
+    insert_free_partition(mem, hole);
+    if (is_cursor_released)
+        mem->cursor = hole;
+    return moved_size;
+}
+
+void mark_partition_allocated(struct memory* mem, struct partition* part, uint64_t requested_size) {
+    part->is_free = false;
+    part->requested_size = requested_size;
+    part->mem = mem;
+    if (mem != NULL) {
+        mem->used_size += part->size;
+        mem->requested_size += requested_size;
+        mem->padding_size += get_alignment_padding(mem, requested_size);
+        mem->allocated_partitions += 1;
     }
 }
 
-struct partition* allocate_partition(struct partition* part, int process_size) {
-    if (part == NULL || process_size > part->size || !part->is_free)
+void release_merged_partition(struct memory* mem, struct partition* part, struct partition* survivor) {
+    if (mem != NULL && mem->cursor == part)
+        mem->cursor = survivor;
+    free_partition(mem, part);
+}
+
+struct partition* allocate_partition(struct memory* mem, struct partition* part, uint64_t process_size) {
+    if (part == NULL || !part->is_free)
+        return NULL;
+    uint64_t block_size = get_block_size(mem, process_size);
+    if (block_size > part->size)
         return NULL;
-    if (part->size > process_size) {
-        struct partition* free_part = get_new_partition(part, part->next, part->size - process_size, true);
+    remove_free_partition(mem, part);
+    uint64_t rest_size = part->size - block_size;
+    if (rest_size > 0 && rest_size >= get_block_size(mem, 0)) {
+        struct partition* free_part;
+        if (mem != NULL)
+            free_part = get_new_memory_partition(mem, part, part->next, part->address + block_size, rest_size, true);
+        else
+            free_part = get_new_partition(part, part->next, rest_size, true);
         if (part->next != NULL)
             part->next->prev = free_part;
         part->next = free_part;
+        insert_free_partition(mem, free_part);
+        part->size = block_size;
     }
-    part->size = process_size;
-    part->is_free = false;
+    mark_partition_allocated(mem, part, process_size);
     return part;
 }
 
 void deallocate_partition(struct partition* part) {
     if (part->is_free) return;
+    struct memory* mem = part->mem;
+    uint64_t requested_size = part->requested_size;
     part->is_free = true;
+    if (mem != NULL) {
+        mem->used_size -= part->size;
+        mem->requested_size -= requested_size;
+        mem->padding_size -= get_alignment_padding(mem, requested_size);
+        mem->allocated_partitions -= 1;
+        if (mem->buddy != NULL) {
+            deallocate_buddy_partition(mem, part);
+            return;
+        }
+        if (mem->bitmap != NULL) {
+            deallocate_bitmap_partition(mem, part);
+            return;
+        }
+        if (mem->table != NULL) {
+            deallocate_table_partition(mem, part);
+            return;
+        }
+    }
     if (part->next != NULL && part->next->is_free) {
+        remove_free_partition(mem, part->next);
         part->size += part->next->size;
         struct partition* part_to_free = part->next;
         part->next = part->next->next;
         if (part->next != NULL) {
             part->next->prev = part;
         }
-        free_partition(part_to_free);
+        release_merged_partition(mem, part_to_free, part);
     }
     if (part->prev != NULL && part->prev->is_free) {
-        part->prev->size += part->size;
-        part->prev->next = part->next;
+        struct partition* prev = part->prev;
+        remove_free_partition(mem, prev);
+        prev->size += part->size;
+        prev->next = part->next;
         if (part->next != NULL) {
-            part->next->prev = part->prev;
+            part->next->prev = prev;
         }
-        free_partition(part);
+        release_merged_partition(mem, part, prev);
+        insert_free_partition(mem, prev);
+    } else {
+        insert_free_partition(mem, part);
     }
 }
 
-struct partition* first_fit(struct memory* mem, int process_size) {
-    struct partition* part = mem->head;
-    while (part != NULL) {
-        if (part->is_free && part->size >= process_size)
-            break;
-        part = part->next;
+struct partition* resize_partition(struct memory* mem, struct partition* part, uint64_t process_size) {
+    if (part == NULL || part->is_free || mem == NULL || mem->buddy != NULL || mem->bitmap != NULL || mem->table != NULL)
+        return NULL;
+    struct partition* next = part->next;
+    bool is_next_free = next != NULL && next->is_free;
+    if (get_block_size(mem, process_size) > part->size + (is_next_free ? next->size : 0))
+        return NULL;
+    mem->used_size -= part->size;
+    mem->requested_size -= part->requested_size;
+    mem->padding_size -= get_alignment_padding(mem, part->requested_size);
+    mem->allocated_partitions -= 1;
+    if (is_next_free) {
+        remove_free_partition(mem, next);
+        part->size += next->size;
+        part->next = next->next;
+        if (part->next != NULL)
+            part->next->prev = part;
+        release_merged_partition(mem, next, part);
     }
-    return allocate_partition(part, process_size);
+    part->is_free = true;
+    insert_free_partition(mem, part);
+    return allocate_partition(mem, part, process_size);
 }
 
-struct partition* best_fit(struct memory* mem, int process_size) {
-    struct partition* part = mem->head;
-    struct partition* best_part = NULL;
-    int min_fragmentation = __INT_MAX__;
-    while (part != NULL) {
-        if (part->is_free && part->size >= process_size) {
-            int fragmentation = part->size - process_size;
-            if (fragmentation < min_fragmentation) {
-                min_fragmentation = fragmentation;
-                best_part = part;
+/*
+Only non-empty free lists of subclasses that can hold the block of `process_size` are visited,
+the lowest address among them is the first fit
+*/
+struct partition* first_fit(struct memory* mem, uint64_t process_size) {
+    struct partition* fit = NULL;
+    uint64_t block_size = get_block_size(mem, process_size);
+    int first_size_class = get_size_class(block_size);
+    int first_size_subclass = get_size_subclass(block_size, first_size_class);
+    uint64_t size_classes = mem->size_class_bitmap & (~0ULL << first_size_class);
+    while (size_classes != 0) {
+        int size_class = __builtin_ctzll(size_classes);
+        size_classes &= size_classes - 1;
+        unsigned int size_subclasses = mem->size_subclass_bitmaps[size_class];
+        if (size_class == first_size_class)
+            size_subclasses &= ~0U << first_size_subclass;
+        while (size_subclasses != 0) {
+            int size_subclass = __builtin_ctz(size_subclasses);
+            size_subclasses &= size_subclasses - 1;
+            for (struct partition* part = mem->free_lists[size_class][size_subclass]; part != NULL; part = part->next_free) {
+                if (part->size >= block_size && (fit == NULL || part->address < fit->address))
+                    fit = part;
             }
         }
-        part = part->next;
     }
-    return allocate_partition(best_part, process_size);
+    return allocate_partition(mem, fit, process_size);
 }
 
-struct partition* next_fit(struct memory* mem, int process_size, int starting_address) {
-    struct partition* part = mem->head;
-    struct partition* fit = NULL;
-    int address = 0;
+struct partition* best_fit(struct memory* mem, uint64_t process_size) {
+    return allocate_partition(mem, find_free_partition_at_least(mem, get_block_size(mem, process_size)), process_size);
+}
+
+/*
+The lowest addressed of the largest free partitions
+*/
+struct partition* worst_fit(struct memory* mem, uint64_t process_size) {
+    uint64_t largest_size = get_largest_free_partition_size(mem);
+    if (largest_size < get_block_size(mem, process_size)) return NULL;
+    return allocate_partition(mem, find_free_partition_at_least(mem, largest_size), process_size);
+}
+
+struct partition* tlsf_fit(struct memory* mem, uint64_t process_size) {
+    uint64_t block_size = get_block_size(mem, process_size);
+    if (block_size > MAX_MEMORY_SIZE) return NULL;
+    int size_class = get_size_class(block_size);
+    uint64_t rounded_size = block_size;
+    if (size_class > NUM_SIZE_SUBCLASSES_LOG2) {
+        rounded_size = block_size + (1ULL << (size_class - NUM_SIZE_SUBCLASSES_LOG2)) - 1;
+        size_class = get_size_class(rounded_size);
+    }
+    unsigned int size_subclasses = mem->size_subclass_bitmaps[size_class] & (~0U << get_size_subclass(rounded_size, size_class));
+    uint64_t size_classes = mem->size_class_bitmap & (~1ULL << size_class);
+    while (true) {
+        if (size_subclasses == 0) {
+            if (size_classes == 0) return NULL;
+            size_class = __builtin_ctzll(size_classes);
+            size_classes &= size_classes - 1;
+            size_subclasses = mem->size_subclass_bitmaps[size_class];
+        }
+        int size_subclass = __builtin_ctz(size_subclasses);
+        size_subclasses &= size_subclasses - 1;
+        // Every partition of the subclass fits, except zero-sized ones sharing the smallest subclass
+        for (struct partition* part = mem->free_lists[size_class][size_subclass]; part != NULL; part = part->next_free) {
+            if (part->size >= block_size)
+                return allocate_partition(mem, part, process_size);
+        }
+    }
+}
+
+/*
+Searches from `start` to the end of memory and then wraps around from the head
+*/
+struct partition* next_fit_from(struct memory* mem, uint64_t process_size, struct partition* start) {
+    uint64_t block_size = get_block_size(mem, process_size);
+    struct partition* part = start;
     while (part != NULL) {
-        if (address >= starting_address) break;
-        if (fit == NULL && part->is_free && part->size >= process_size)
-            fit = part;
-        address += part->size;
+        if (part->is_free && part->size >= block_size)
+            return allocate_partition(mem, part, process_size);
         part = part->next;
     }
-    while (part != NULL) {
-        if (part->is_free && part->size >= process_size) {
-            fit = part;
-            break;
-        }
+    part = mem->head;
+    while (part != start) {
+        if (part->is_free && part->size >= block_size)
+            return allocate_partition(mem, part, process_size);
         part = part->next;
     }
-    return allocate_partition(fit, process_size);
+    return NULL;
 }
 
-int get_address_of_partition(struct memory* mem, struct partition* part) {
-    struct partition* iter = mem->head;
-    int address = 0;
-    while (iter != NULL) {
-        if (iter == part) break;
-        address += iter->size;
-        iter = iter->next;
-    }
-    return address;
+struct partition* next_fit(struct memory* mem, uint64_t process_size, uint64_t starting_address) {
+    struct partition* part = mem->head;
+    while (part != NULL && part->address < starting_address)
+        part = part->next;
+    return next_fit_from(mem, process_size, part);
+}
+
+struct partition* roving_next_fit(struct memory* mem, uint64_t process_size) {
+    struct partition* start = mem->cursor == NULL ? mem->head : mem->cursor;
+    struct partition* part = next_fit_from(mem, process_size, start);
+    if (part != NULL)
+        mem->cursor = part;
+    return part;
+}
+
+uint64_t get_address_of_partition(struct partition* part) {
+    return part->address;
 }
 
 float get_percentage_memory_utilization(struct memory* mem) {
-    struct partition* iter = mem->head;
-    int utilization_in_MB = mem->q;
-    while (iter != NULL) {
-        utilization_in_MB += iter->is_free ? 0 : iter->size;
-        iter = iter->next;
-    }
-    return (100.0f * utilization_in_MB) / mem->p;
+    return (float)(100.0 * (mem->q + mem->used_size) / mem->p);
 }
 
-void print_memory(struct memory* mem) {
-    struct partition* part = mem->head;
-    log_info("┌────────┐");
-    log_info("│ %s %4d │", part->is_free ? " " : "✓", part->size);
-    part = part->next;
-    while (part != NULL) {
-        log_info("├────────┤");
-        log_info("│ %s %4d │", part->is_free ? " " : "✓", part->size);
-        part = part->next;
-    }
-    log_info("└────────┘");
-    fflush(stdout);
+uint64_t get_largest_free_partition_size(struct memory* mem) {
+    if (mem->bitmap != NULL)
+        return get_largest_free_bitmap_run_size(mem);
+    if (mem->table != NULL)
+        return get_largest_free_table_entry_size(mem);
+    return mem->largest_free_partition == NULL ? 0 : mem->largest_free_partition->size;
 }
 
-void init_process_queue_node(struct process_queue_node* node, struct process* proc, struct process_queue_node* prev, struct process_queue_node* next) {
-    node->proc = proc;
-    node->prev = prev;
-    node->next = next;
+float get_percentage_internal_fragmentation(struct memory* mem) {
+    if (mem->used_size == 0) return 0;
+    return (float)(100.0 * (mem->used_size - mem->requested_size) / mem->used_size);
 }
 
-struct process_queue_node* get_new_empty_process_queue_node() {
-    return (struct process_queue_node*)malloc(sizeof(struct process_queue_node));
+float get_percentage_alignment_padding(struct memory* mem) {
+    if (mem->used_size == 0) return 0;
+    return (float)(100.0 * mem->padding_size / mem->used_size);
 }
 
-struct process_queue_node* get_new_process_queue_node(struct process* proc, struct process_queue_node* prev, struct process_queue_node* next) {
-    struct process_queue_node* node = get_new_empty_process_queue_node();
-    init_process_queue_node(node, proc, prev, next);
-    return node;
+float get_percentage_external_fragmentation(struct memory* mem) {
+    if (mem->free_size == 0) return 0;
+    return (float)(100.0 * (mem->free_size - get_largest_free_partition_size(mem)) / mem->free_size);
 }
 
-void free_process_queue_node(struct process_queue_node* node) {
-    free_process(node->proc);
-    free(node);
+void print_memory(struct memory* mem) {
+    if (!is_log_level_enabled(LOG_LEVEL_INFO)) return;
+    if (mem->bitmap != NULL || mem->table != NULL) {
+        if (mem->bitmap != NULL)
+            print_bitmap_memory(mem);
+        else
+            print_table_memory(mem);
+        if (!is_async_logging()) fflush(stdout);
+        return;
+    }
+    struct partition* part = mem->head;
+    log_info("┌────────────┐");
+    log_info("│ %s %8.1f │", part->is_free ? " " : "✓", get_size_in_mb(part->size));
+    part = part->next;
+    while (part != NULL) {
+        log_info("├────────────┤");
+        log_info("│ %s %8.1f │", part->is_free ? " " : "✓", get_size_in_mb(part->size));
+        part = part->next;
+    }
+    log_info("└────────────┘");
+    if (!is_async_logging()) fflush(stdout);
+}
+
+int get_queue_size(struct process_queue* queue) {
+    return atomic_load_explicit(&queue->tail, memory_order_acquire) - atomic_load_explicit(&queue->head, memory_order_acquire);
 }
 
 bool is_queue_full(struct process_queue* queue) {
-    return queue->size == queue->max_size;
+    long tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    return tail - atomic_load_explicit(&queue->head, memory_order_acquire) >= queue->max_size;
 }
 
 bool is_queue_empty(struct process_queue* queue) {
-    return queue->size == 0;
+    long head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    return atomic_load_explicit(&queue->tail, memory_order_acquire) == head;
 }
 
 void init_queue(struct process_queue* queue, int max_size) {
+    long slots = 1;
+    while (slots < max_size) slots *= 2;
     queue->max_size = max_size;
-    queue->size = 0;
-    queue->head = NULL;
-    queue->tail = NULL;
+    queue->mask = slots - 1;
+    queue->slots = (struct process**)malloc(slots * sizeof(struct process*));
+    queue->process_pool = get_new_object_pool(sizeof(struct process), OBJECTS_PER_POOL_CHUNK, true);
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
 }
 
 struct process_queue* get_new_empty_queue(int max_size) {
-    struct process_queue* queue = (struct process_queue*)malloc(sizeof(struct process_queue));
+    struct process_queue* queue = (struct process_queue*)aligned_alloc(CACHE_LINE_SIZE, sizeof(struct process_queue));
     init_queue(queue, max_size);
     return queue;
 }
 
-bool __enqueue(struct process_queue* queue, struct process* proc) {
-    struct process_queue_node* node = get_new_process_queue_node(proc, NULL, queue->head);
-    if (is_queue_empty(queue)) {
-        queue->head = node;
-        queue->tail = node;
-        queue->size = 1;
-        return true;
-    } else if (is_queue_full(queue)) {
+bool enqueue(struct process_queue* queue, struct process* proc) {
+    long tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&queue->head, memory_order_acquire) >= queue->max_size)
         return false;
-    } else {
-        queue->head->prev = node;
-        queue->head = node;
-        queue->size += 1;
-        return true;
-    }
+    queue->slots[tail & queue->mask] = proc;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
 }
 
-bool enqueue(struct process_queue* queue, struct process* proc) {
-    bool response = __enqueue(queue, proc);
-    return response;
+struct process* dequeue(struct process_queue* queue) {
+    long head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (atomic_load_explicit(&queue->tail, memory_order_acquire) == head)
+        return NULL;
+    struct process* proc = queue->slots[head & queue->mask];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return proc;
 }
 
-struct process* __dequeue(struct process_queue* queue) {
-    if (is_queue_empty(queue)) {
+struct process* peek_queue(struct process_queue* queue) {
+    long head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (atomic_load_explicit(&queue->tail, memory_order_acquire) == head)
         return NULL;
-    } else if (queue->size == 1) {
-        struct process_queue_node* removed_node = queue->tail;
-        struct process* proc = removed_node->proc;
-        queue->head = NULL;
-        queue->tail = NULL;
-        queue->size = 0;
-        free(removed_node);
-        return proc;
-    } else {
-        struct process_queue_node* removed_node = queue->tail;
-        struct process* proc = removed_node->proc;
-        queue->tail = queue->tail->prev;
-        queue->tail->next = NULL;
-        queue->size -= 1;
-        free(removed_node);
-        return proc;
-    }
+    return queue->slots[head & queue->mask];
 }
 
-struct process* dequeue(struct process_queue* queue) {
-    struct process* response = __dequeue(queue);
-    return response;
+struct process* peek_queue_at(struct process_queue* queue, int offset) {
+    long head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (offset < 0 || atomic_load_explicit(&queue->tail, memory_order_acquire) <= head + offset)
+        return NULL;
+    return queue->slots[(head + offset) & queue->mask];
 }
 
-struct process* peek_queue(struct process_queue* queue) {
-    if (is_queue_empty(queue)) {
+struct process* dequeue_at(struct process_queue* queue, int offset) {
+    long head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (offset < 0 || atomic_load_explicit(&queue->tail, memory_order_acquire) <= head + offset)
         return NULL;
-    } else {
-        return queue->tail->proc;
-    }
+    struct process* proc = queue->slots[(head + offset) & queue->mask];
+    for (long i = head + offset; i > head; i--)
+        queue->slots[i & queue->mask] = queue->slots[(i - 1) & queue->mask];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return proc;
 }
 
 void free_queue(struct process_queue* queue) {
-    struct process_queue_node* node = queue->head;
-    while (node != NULL) {
-        free_process_queue_node(node);
-        node = node->next;
+    long tail = atomic_load(&queue->tail);
+    for (long i = atomic_load(&queue->head); i < tail; i++) {
+        struct process* proc = queue->slots[i & queue->mask];
+        if (proc->pool != queue->process_pool)
+            free_process(proc);
     }
+    free_object_pool(queue->process_pool);
+    free(queue->slots);
     free(queue);
 }
 
 void free_process(struct process* proc) {
-    free(proc);
+    if (proc->pool != NULL)
+        pool_free(proc->pool, proc);
+    else
+        free(proc);
 }
 
-void free_partition(struct partition* part) {
-    free(part);
+void free_partition(struct memory* mem, struct partition* part) {
+    if (mem != NULL && mem->base != NULL)
+        return;  // The header is just bytes of the arena
+    if (mem != NULL)
+        pool_free(mem->partition_pool, part);
+    else
+        free(part);
 }
 
 void free_memory(struct memory* mem) {
-    struct partition* part = mem->head;
-    while (part != NULL) {
-        struct partition* part_to_free = part;
-        part = part->next;
-        free_partition(part_to_free);
-    }
+    if (mem->buddy != NULL)
+        free_buddy_allocator(mem->buddy);
+    if (mem->bitmap != NULL)
+        free_bitmap_allocator(mem->bitmap);
+    if (mem->table != NULL)
+        free_partition_table(mem->table);
+    if (mem->partition_pool != NULL)
+        free_object_pool(mem->partition_pool);
     free(mem);
 }
\ No newline at end of file
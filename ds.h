@@ -1,79 +1,277 @@
 #ifndef CS303_DS_H
 #define CS303_DS_H
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/time.h>
 
+#include "histogram.h"
+#include "pool.h"
+
+#define NUM_SIZE_CLASSES (64)  // Free partitions are bucketed by floor(log2(size))
+#define NUM_SIZE_SUBCLASSES_LOG2 (3)
+#define NUM_SIZE_SUBCLASSES (1 << NUM_SIZE_SUBCLASSES_LOG2)  // Each size class is split linearly into subclasses
+#define OBJECTS_PER_POOL_CHUNK (256)
+#define CACHE_LINE_SIZE (64)
+#define BYTES_PER_MB (1024ULL * 1024ULL)
+#define MAX_MEMORY_SIZE (1ULL << 56)  // Addresses are 56 bits wide, see struct partition
+
 struct process {
-    int s;  // Size of process in MBs
+    uint64_t s;  // Size of process in bytes
     int d;  // Duration of process in seconds
     struct timeval arrival_time;
+    struct object_pool* pool;  // Pool the process was allocated from, NULL if malloc'd
 };
 
+/*
+Fits in a cache line: the free list and free tree links are only needed while the partition is free
+and share their space with the fields only needed while it is allocated
+Functions working on free partitions take the memory indexing them as a parameter
+*/
 struct partition {
     struct partition* prev;
     struct partition* next;
-    int size;  // Size of partition in MBs
-    int is_free;
+    uint64_t address : 56;    // Start of partition in bytes
+    uint64_t tree_height : 7;
+    uint64_t is_free : 1;
+    uint64_t size;  // Size of partition in bytes
+    union {
+        struct {
+            struct partition* prev_free;  // Neighbours in the free list of its size subclass
+            struct partition* next_free;
+            struct partition* tree_left;  // Children in the AVL tree of free partitions keyed by (size, address)
+            struct partition* tree_right;
+        };
+        struct {
+            uint64_t requested_size;  // Bytes asked for by the process, the rest of the partition is internal fragmentation
+            struct memory* mem;       // Memory the partition was allocated from, NULL for a detached partition
+        };
+    };
 };
 
-struct memory {
-    int p;  // Total memory in MBs
-    int q;  // Memory reserved for OS
-    struct partition* head;
+_Static_assert(sizeof(struct partition) <= CACHE_LINE_SIZE, "struct partition must fit in a cache line");
+
+/*
+Granularity of a memory
+Every partition starts at a multiple of `alignment` and no free partition smaller than `min_block_size` is split off
+*/
+struct block_layout {
+    uint64_t alignment;  // Power of two
+    uint64_t min_block_size;
 };
 
-struct process_queue_node {
-    struct process* proc;
-    struct process_queue_node* prev;
-    struct process_queue_node* next;
+struct memory {
+    uint64_t p;  // Total memory in bytes
+    uint64_t q;  // Memory reserved for OS
+    struct block_layout layout;
+    struct partition* head;
+    struct partition* free_lists[NUM_SIZE_CLASSES][NUM_SIZE_SUBCLASSES];  // Free partitions by size class and subclass
+    uint64_t size_class_bitmap;                                           // Bit i is set iff size class i has a free partition
+    unsigned int size_subclass_bitmaps[NUM_SIZE_CLASSES];                 // Bit j of entry i is set iff free_lists[i][j] is non-empty
+    struct partition* free_tree;                     // Free partitions ordered by (size, address)
+    struct partition* cursor;                        // Partition where the next roving next fit resumes
+    struct object_pool* partition_pool;              // Backs every partition of this memory, NULL if `base` is set
+    char* base;                                      // Arena holding each partition inline at base + address, NULL if pooled
+    uint64_t used_size;                              // Allocated bytes, excluding the reserved memory
+    uint64_t free_size;
+    int free_partitions;
+    int allocated_partitions;
+    struct partition* largest_free_partition;        // Last node of `free_tree`, NULL if memory is full
+    uint64_t requested_size;                         // Bytes asked for by the processes holding `used_size`
+    uint64_t padding_size;                           // Bytes of `used_size` that only align the requested sizes
+    struct buddy_allocator* buddy;                   // Buddy system state, NULL unless created by get_new_buddy_memory()
+    struct bitmap_allocator* bitmap;                 // Fixed unit state, NULL unless created by get_new_bitmap_memory()
+    struct partition_table* table;                   // Structure of arrays state, NULL unless created by get_new_table_memory()
 };
 
+/*
+Bounded single-producer/single-consumer ring buffer
+Only one thread may enqueue and only one thread may dequeue, no lock is needed between the two
+Several consumers may take turns dequeuing if they hold a common lock while they do
+*/
 struct process_queue {
     int max_size;
-    int size;
-    struct process_queue_node* head;
-    struct process_queue_node* tail;
+    long mask;  // Number of slots minus one, the number of slots is a power of two >= max_size
+    struct process** slots;
+    struct object_pool* process_pool;  // Processes created for this queue, see get_new_queued_process()
+    _Alignas(CACHE_LINE_SIZE) _Atomic long head;  // Next slot to dequeue, written only by the consumer
+    _Alignas(CACHE_LINE_SIZE) _Atomic long tail;  // Next slot to enqueue, written only by the producer
 };
 
 struct stats {
     long turnaround_time_num;
     int turnaround_time_den;
-    int memory_utilization_num;
+    double memory_utilization_num;
     int memory_utilization_den;
+    double internal_fragmentation_num;
+    int internal_fragmentation_den;
+    double alignment_padding_num;
+    int alignment_padding_den;
+    int compactions;
+    long compaction_moved_size;      // Bytes relocated by compaction
+    long compaction_time_in_millis;  // Simulated time spent relocating
+    struct histogram queue_wait_time;  // Milliseconds from arrival to allocation
+    struct histogram turnaround_time;  // Milliseconds from arrival to completion
+    _Atomic long dropped_arrivals;     // Arrivals lost to a full queue, counted by the thread generating them
 };
 
 struct stats* get_empty_stats();
 
-struct process* get_new_process(int s, int d, struct timeval arrival_time);
+struct process* get_new_process(uint64_t s, int d, struct timeval arrival_time);
+
+/*
+Allocates the process from the process pool of `queue`, it is released with the queue by free_queue()
+*/
+struct process* get_new_queued_process(struct process_queue* queue, uint64_t s, int d, struct timeval arrival_time);
+
+double get_size_in_mb(uint64_t size);
+
+struct partition* get_new_partition(struct partition* prev, struct partition* next, uint64_t size, int is_free);
+
+void init_block_layout(struct block_layout* layout, uint64_t alignment, uint64_t min_block_size);
+
+/*
+Byte granular memory of `p` bytes, `q` of which are reserved
+*/
+struct memory* get_new_empty_memory(uint64_t p, uint64_t q);
+
+/*
+Same as get_new_empty_memory() with the granularity of `layout`, the reserved memory grows so that the rest is a whole number of aligned blocks
+*/
+struct memory* get_new_memory_with_layout(uint64_t p, uint64_t q, struct block_layout* layout);
+
+/*
+Initializes `mem` in place without allocating
+If `base` is not NULL every partition header is written inline at base + address, the layout must then keep
+whole partition headers inside every block and partitions are never moved or released
+*/
+void init_memory(struct memory* mem, uint64_t p, uint64_t q, struct block_layout* layout, char* base);
+
+int get_size_class(uint64_t size);
 
-struct partition* get_new_partition(struct partition* prev, struct partition* next, int size, int is_free);
+/*
+Position of `size` within its size class, subclasses split [2^i, 2^(i + 1)) into equal ranges
+*/
+int get_size_subclass(uint64_t size, int size_class);
+
+uint64_t get_aligned_size(uint64_t size, uint64_t alignment);
 
-struct memory* get_new_empty_memory(int p, int q);
+/*
+Size of the partition a process of `size` bytes takes from `mem`, NULL `mem` keeps the size
+*/
+uint64_t get_block_size(struct memory* mem, uint64_t size);
 
 /*
-Allocated memory on partition `part`
-Returns NULL is memory could not be allocated
-        `part` is memory was allocated
+Bytes added to `size` only to reach the alignment of `mem`
 */
-struct partition* allocate_partition(struct partition* part, int process_size);
+uint64_t get_alignment_padding(struct memory* mem, uint64_t size);
+
+/*
+Returns the free partition with the smallest (size, address) such that size >= `size`
+        NULL if no free partition is large enough
+*/
+struct partition* find_free_partition_at_least(struct memory* mem, uint64_t size);
+
+/*
+Helpers for placement engines that manage the partition list themselves
+*/
+struct partition* get_new_memory_partition(struct memory* mem, struct partition* prev, struct partition* next, uint64_t address, uint64_t size, int is_free);
+
+void insert_free_partition(struct memory* mem, struct partition* part);
+
+void remove_free_partition(struct memory* mem, struct partition* part);
+
+/*
+Marks the free, unindexed partition `part` as holding a process of `requested_size` bytes
+*/
+void mark_partition_allocated(struct memory* mem, struct partition* part, uint64_t requested_size);
+
+/*
+Unlinks `part` after it was merged into its neighbour `survivor` and frees it
+*/
+void release_merged_partition(struct memory* mem, struct partition* part, struct partition* survivor);
+
+/*
+Allocates a block for a process of `process_size` bytes at the start of the free partition `part` of `mem`
+The block is rounded up to the alignment and to the minimum block size, a remainder smaller than the minimum block size stays in the block
+`mem` is NULL for a detached partition
+Returns NULL if memory could not be allocated
+        `part` if memory was allocated
+*/
+struct partition* allocate_partition(struct memory* mem, struct partition* part, uint64_t process_size);
 
 void deallocate_partition(struct partition* part);
 
-struct partition* first_fit(struct memory* mem, int process_size);
+/*
+Resizes an allocated partition in place, growing it into its free successor or splitting its tail off
+Returns NULL and leaves the partition untouched if it cannot hold `process_size` bytes in place
+*/
+struct partition* resize_partition(struct memory* mem, struct partition* part, uint64_t process_size);
+
+/*
+Slides every allocated partition towards address 0 and merges all free memory into one partition at the end
+Partitions keep their identity, only their addresses change
+Returns the number of bytes relocated, buddy, bitmap and table memories are left untouched
+so are arena memories, whose partition headers and payloads live at base + address
+*/
+uint64_t compact_memory(struct memory* mem);
 
-struct partition* best_fit(struct memory* mem, int process_size);
+struct partition* first_fit(struct memory* mem, uint64_t process_size);
 
-struct partition* next_fit(struct memory* mem, int process_size, int starting_address);
+struct partition* best_fit(struct memory* mem, uint64_t process_size);
 
-int get_address_of_partition(struct memory* mem, struct partition* part);
+struct partition* worst_fit(struct memory* mem, uint64_t process_size);
 
+/*
+Two-level segregated fit, takes a partition from the first non-empty subclass whose partitions all hold `process_size`
+Runs in constant time using find-first-set on the size class and subclass bitmaps
+*/
+struct partition* tlsf_fit(struct memory* mem, uint64_t process_size);
+
+struct partition* next_fit(struct memory* mem, uint64_t process_size, uint64_t starting_address);
+
+/*
+Next fit resuming from `mem->cursor`, the cursor is moved to the allocated partition
+*/
+struct partition* roving_next_fit(struct memory* mem, uint64_t process_size);
+
+uint64_t get_address_of_partition(struct partition* part);
+
+/*
+Utilization and fragmentation are read from counters kept up to date by allocate_partition() and deallocate_partition()
+*/
 float get_percentage_memory_utilization(struct memory* mem);
 
+uint64_t get_largest_free_partition_size(struct memory* mem);
+
+/*
+Share of free memory that lies outside the largest free partition
+*/
+float get_percentage_external_fragmentation(struct memory* mem);
+
+/*
+Share of allocated memory not asked for by the processes holding it
+*/
+float get_percentage_internal_fragmentation(struct memory* mem);
+
+/*
+Share of allocated memory that only aligns the requested sizes, part of the internal fragmentation
+*/
+float get_percentage_alignment_padding(struct memory* mem);
+
 void print_memory(struct memory* mem);
 
+int get_queue_size(struct process_queue* queue);
+
+/*
+Producer side
+*/
 bool is_queue_full(struct process_queue* queue);
 
+/*
+Consumer side
+*/
 bool is_queue_empty(struct process_queue* queue);
 
 void init_queue(struct process_queue* queue, int max_size);
@@ -86,12 +284,30 @@ struct process* dequeue(struct process_queue* queue);
 
 struct process* peek_queue(struct process_queue* queue);
 
+/*
+Process `offset` places behind the head, NULL if the queue is shorter
+Consumer side only
+*/
+struct process* peek_queue_at(struct process_queue* queue, int offset);
+
+/*
+Removes the process `offset` places behind the head, the processes in front of it move back by one
+Consumer side only, the producer never touches the slots in front of the tail
+*/
+struct process* dequeue_at(struct process_queue* queue, int offset);
+
 void free_queue(struct process_queue* queue);
 
 void free_process(struct process* proc);
 
-void free_partition(struct partition* part);
+/*
+`mem` is the memory the partition belongs to, NULL for a detached partition
+*/
+void free_partition(struct memory* mem, struct partition* part);
 
+/*
+Releases the memory along with all of its partitions
+*/
 void free_memory(struct memory* mem);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "event_simulator.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "arrival.h"
+#include "backfill.h"
+#include "compaction.h"
+#include "ds.h"
+#include "heap.h"
+#include "helper.h"
+#include "logger.h"
+#include "rng.h"
+#include "scheduling.h"
+#include "pool.h"
+#include "simulator.h"
+#include "trace.h"
+
+
+enum event_type {
+    PROCESS_ARRIVAL,
+    PROCESS_COMPLETION
+};
+
+struct event {
+    enum event_type type;
+    struct process* proc;
+    struct partition* part;
+};
+
+struct event_simulation {
+    long now;  // Virtual time in milliseconds
+    long end;
+    int m;
+    int t;
+    struct arrival_generator arrivals;
+    int next_batch_size;  // Processes arriving with the pending arrival event
+    enum placement_algo algo;
+    struct memory* mem;
+    struct process_queue* queue;
+    struct process_scheduler* scheduler;  // Consumer side of `queue`
+    struct min_heap* events;
+    struct object_pool* event_pool;
+    struct stats* stat;
+    struct compaction_policy* compaction;
+    struct trace_reader* replay;  // Source of arrivals if not NULL
+    struct trace_writer* record;
+    struct backfill_scheduler* backfill;  // Lets queued processes overtake the head if not NULL
+    struct rng rng;            // Simulations running side by side never share a generator
+    bool is_memory_exhausted;  // Head of the queue did not fit, retry only after a completion or, with backfilling, an arrival
+};
+
+struct timeval get_virtual_time(long millis) {
+    struct timeval t;
+    t.tv_sec = millis / 1000;
+    t.tv_usec = (millis % 1000) * 1000;
+    return t;
+}
+
+void schedule_event(struct event_simulation* sim, long time, enum event_type type, struct process* proc, struct partition* part) {
+    struct event* e = (struct event*)pool_alloc(sim->event_pool);
+    e->type = type;
+    e->proc = proc;
+    e->part = part;
+    heap_push(sim->events, time, e);
+}
+
+/*
+Draws the next batch of arrivals like process_creator()
+When replaying, the next arrival is the next record of the trace instead
+*/
+void schedule_next_arrival(struct event_simulation* sim) {
+    if (sim->replay != NULL) {
+        const struct trace_record* arrival = peek_trace_record(sim->replay);
+        if (arrival != NULL && (long)arrival->arrival_offset_in_millis <= sim->end)
+            schedule_event(sim, arrival->arrival_offset_in_millis, PROCESS_ARRIVAL, NULL, NULL);
+        return;
+    }
+    double time_in_millis;
+    sim->next_batch_size = next_arrival_batch(&sim->arrivals, &sim->rng, &time_in_millis);
+    if (sim->next_batch_size > 0 && time_in_millis <= sim->end)
+        schedule_event(sim, (long)time_in_millis, PROCESS_ARRIVAL, NULL, NULL);
+}
+
+void handle_arrival(struct event_simulation* sim) {
+    const struct trace_record* arrival = sim->replay != NULL ? next_trace_record(sim->replay) : NULL;
+    int batch_size = arrival != NULL ? 1 : sim->next_batch_size;
+    for (int i = 0; i < batch_size; i++) {
+        struct process* proc;
+        if (arrival != NULL)
+            proc = get_new_queued_process(sim->queue, arrival->size, arrival->duration, get_virtual_time(sim->now));
+        else
+            proc = get_random_process(sim->queue, sim->m, sim->t, get_virtual_time(sim->now), &sim->rng);  // Drawn even if it is dropped, so a drop does not shift the draws after it
+        if (sim->record != NULL)
+            write_trace_record(sim->record, sim->now, proc->s, proc->d);  // Dropped arrivals are recorded too, the trace holds every arrival
+        log_info("New process (s: %.2fMB, d: %ds) generated", get_size_in_mb(proc->s), proc->d);
+        if (enqueue(sim->queue, proc)) {
+            log_info("Process (s: %.2fMB, d: %ds) queued", get_size_in_mb(proc->s), proc->d);
+            if (sim->backfill != NULL)
+                sim->is_memory_exhausted = false;  // It may fit where the queued processes do not
+        } else {
+            log_warning("Process (s: %.2fMB, d: %ds) could NOT be queued, queue full", get_size_in_mb(proc->s), proc->d);
+            atomic_fetch_add(&sim->stat->dropped_arrivals, 1);
+            free_process(proc);
+        }
+    }
+    schedule_next_arrival(sim);
+}
+
+void handle_completion(struct event_simulation* sim, struct event* e) {
+    uint64_t address = get_address_of_partition(e->part);
+    uint64_t size = e->part->size;
+    deallocate_partition(e->part);
+    log_warning("%.2fMB partition [%lu, %lu] freed from process (s: %.2fMB, d: %ds)", get_size_in_mb(size), address, address + size, get_size_in_mb(e->proc->s), e->proc->d);
+    free_process(e->proc);
+    sim->is_memory_exhausted = false;
+}
+
+/*
+Allocates queued processes in scheduling order until the next one does not fit
+or, with backfilling, until no queued process fits
+*/
+void allocate_queued_processes(struct event_simulation* sim) {
+    struct stats* stat = sim->stat;
+    while (!sim->is_memory_exhausted && has_scheduled_process(sim->scheduler)) {
+        int offset = sim->backfill != NULL ? find_backfill_process(sim->backfill, sim->queue, sim->mem) : 0;
+        if (offset < 0) offset = 0;  // Nothing fits, the head may still fit after compaction
+        struct process* proc = sim->backfill != NULL ? peek_queue_at(sim->queue, offset) : peek_scheduled_process(sim->scheduler);
+        log_info("Spawing process (s: %.2fMB, d: %ds)", get_size_in_mb(proc->s), proc->d);
+
+        long start_time = sim->now;
+        struct partition* part = allocate(sim->mem, proc, sim->algo);
+        if (part == NULL && should_compact_after_failure(sim->compaction, sim->mem, proc->s)) {
+            start_time += compact_and_record(sim->compaction, sim->mem, stat, sim->now);  // The process waits for the relocation
+            part = allocate(sim->mem, proc, sim->algo);
+        }
+        if (part != NULL) {
+            record_process_start(stat, proc, get_time_diff_in_millis(proc->arrival_time, get_virtual_time(start_time)));
+            if (sim->backfill != NULL)
+                take_backfill_process(sim->backfill, sim->queue, offset);
+            else
+                dequeue_scheduled_process(sim->scheduler);
+            schedule_event(sim, start_time + proc->d * 1000L, PROCESS_COMPLETION, proc, part);
+            uint64_t address = get_address_of_partition(part);
+            log_info("Process (s: %.2fMB, d: %ds) allocated %.2fMB partition [%lu, %lu]", get_size_in_mb(proc->s), proc->d, get_size_in_mb(part->size), address, address + part->size);
+
+            print_memory(sim->mem);
+
+            log_stats(stat);
+        } else {
+            log_warning("Not enough memory for process (s: %.2fMB, d: %ds)", get_size_in_mb(proc->s), proc->d);
+            sim->is_memory_exhausted = true;
+        }
+        record_memory_stats(stat, sim->mem);
+    }
+}
+
+void run_event_driven(int p, int q, int m, int t, float r, struct arrival_model* arrivals, enum placement_algo algo, struct block_layout* layout, int MAX_QUEUE_SIZE, int T, uint64_t seed, struct trace_reader* replay, struct trace_writer* record, enum scheduling_policy scheduling, struct backfill_scheduler* backfill, struct compaction_policy* compaction, struct stats* stat) {
+    struct event_simulation sim;
+    sim.now = 0;
+    sim.end = T * 60 * 1000L;
+    sim.m = m;
+    sim.t = t;
+    init_arrival_generator(&sim.arrivals, arrivals, r);
+    sim.next_batch_size = 0;
+    sim.algo = algo;
+    sim.mem = get_new_memory_for_algo(p * BYTES_PER_MB, q * BYTES_PER_MB, algo, layout);
+    sim.queue = get_new_empty_queue(MAX_QUEUE_SIZE);
+    sim.scheduler = get_new_process_scheduler(sim.queue, scheduling);
+    sim.events = get_new_min_heap(MAX_QUEUE_SIZE + 1);
+    sim.event_pool = get_new_object_pool(sizeof(struct event), OBJECTS_PER_POOL_CHUNK, false);
+    sim.stat = stat;
+    sim.compaction = compaction;
+    seed_rng(&sim.rng, seed);
+    sim.replay = replay;
+    sim.record = record;
+    sim.backfill = backfill;
+    sim.is_memory_exhausted = false;
+
+    schedule_next_arrival(&sim);
+    long time;
+    while (heap_peek(sim.events, &time) != NULL && time <= sim.end) {
+        struct event* e = (struct event*)heap_pop(sim.events, NULL);
+        sim.now = time;
+        switch (e->type) {
+            case PROCESS_ARRIVAL:
+                handle_arrival(&sim);
+                break;
+            case PROCESS_COMPLETION:
+                handle_completion(&sim, e);
+                break;
+        }
+        pool_free(sim.event_pool, e);
+        if (should_compact(compaction, sim.mem, sim.now)) {
+            compact_and_record(compaction, sim.mem, stat, sim.now);
+            sim.is_memory_exhausted = false;
+        }
+        allocate_queued_processes(&sim);
+    }
+
+    free_min_heap(sim.events);
+    free_object_pool(sim.event_pool);
+    free_process_scheduler(sim.scheduler);
+    free_queue(sim.queue);
+    free_memory(sim.mem);
+}
@@ -0,0 +1,25 @@
+#ifndef CS303_EVENT_SIMULATOR_H
+#define CS303_EVENT_SIMULATOR_H
+
+#include <stdint.h>
+
+#include "arrival.h"
+#include "backfill.h"
+#include "compaction.h"
+#include "ds.h"
+#include "scheduling.h"
+#include "simulator.h"
+#include "trace.h"
+
+/*
+Runs the same simulation as run() on a virtual clock
+Arrivals and completions are timestamped events, so a T minute simulation takes as long as the CPU needs to process them
+Every random draw comes from `seed`, so runs with the same seed are identical and several runs may share a process
+Processes arrive from `replay` if not NULL and every arrival is appended to `record` if not NULL, see run()
+Queued processes are allocated in the order of `scheduling` and overtake a head that does not fit if `backfill` is not NULL
+Compaction delays the process that triggered it by the relocation time
+Returns after T simulated minutes
+*/
+void run_event_driven(int p, int q, int m, int t, float r, struct arrival_model* arrivals, enum placement_algo algo, struct block_layout* layout, int MAX_QUEUE_SIZE, int T, uint64_t seed, struct trace_reader* replay, struct trace_writer* record, enum scheduling_policy scheduling, struct backfill_scheduler* backfill, struct compaction_policy* compaction, struct stats* stat);
+
+#endif
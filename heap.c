@@ -0,0 +1,67 @@
+#include "heap.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+struct min_heap* get_new_min_heap(int initial_capacity) {
+    struct min_heap* heap = (struct min_heap*)malloc(sizeof(struct min_heap));
+    heap->size = 0;
+    heap->capacity = initial_capacity > 0 ? initial_capacity : 1;
+    heap->next_sequence = 0;
+    heap->entries = (struct heap_entry*)malloc(heap->capacity * sizeof(struct heap_entry));
+    return heap;
+}
+
+bool is_heap_entry_less(struct heap_entry* a, struct heap_entry* b) {
+    return a->key < b->key || (a->key == b->key && a->sequence < b->sequence);
+}
+
+void heap_push(struct min_heap* heap, long key, void* item) {
+    if (heap->size == heap->capacity) {
+        heap->capacity *= 2;
+        heap->entries = (struct heap_entry*)realloc(heap->entries, heap->capacity * sizeof(struct heap_entry));
+    }
+    struct heap_entry entry = {key, heap->next_sequence++, item};
+    int i = heap->size++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!is_heap_entry_less(&entry, &heap->entries[parent])) break;
+        heap->entries[i] = heap->entries[parent];
+        i = parent;
+    }
+    heap->entries[i] = entry;
+}
+
+void* heap_pop(struct min_heap* heap, long* key) {
+    if (is_heap_empty(heap)) return NULL;
+    struct heap_entry top = heap->entries[0];
+    struct heap_entry last = heap->entries[--heap->size];
+    int i = 0;
+    while (true) {
+        int child = 2 * i + 1;
+        if (child >= heap->size) break;
+        if (child + 1 < heap->size && is_heap_entry_less(&heap->entries[child + 1], &heap->entries[child]))
+            child++;
+        if (!is_heap_entry_less(&heap->entries[child], &last)) break;
+        heap->entries[i] = heap->entries[child];
+        i = child;
+    }
+    heap->entries[i] = last;
+    if (key != NULL) *key = top.key;
+    return top.item;
+}
+
+void* heap_peek(struct min_heap* heap, long* key) {
+    if (is_heap_empty(heap)) return NULL;
+    if (key != NULL) *key = heap->entries[0].key;
+    return heap->entries[0].item;
+}
+
+bool is_heap_empty(struct min_heap* heap) {
+    return heap->size == 0;
+}
+
+void free_min_heap(struct min_heap* heap) {
+    free(heap->entries);
+    free(heap);
+}
@@ -0,0 +1,38 @@
+#ifndef CS303_HEAP_H
+#define CS303_HEAP_H
+
+#include <stdbool.h>
+
+struct heap_entry {
+    long key;
+    long sequence;  // Insertion order, breaks ties between equal keys
+    void* item;
+};
+
+/*
+Binary min-heap of items ordered by key, items with equal keys come out in insertion order
+*/
+struct min_heap {
+    int size;
+    int capacity;
+    long next_sequence;
+    struct heap_entry* entries;
+};
+
+struct min_heap* get_new_min_heap(int initial_capacity);
+
+void heap_push(struct min_heap* heap, long key, void* item);
+
+/*
+Returns the item with the smallest key and stores its key in `key` if not NULL
+        NULL if the heap is empty
+*/
+void* heap_pop(struct min_heap* heap, long* key);
+
+void* heap_peek(struct min_heap* heap, long* key);
+
+bool is_heap_empty(struct min_heap* heap);
+
+void free_min_heap(struct min_heap* heap);
+
+#endif
@@ -2,7 +2,14 @@
 
 #include <stdlib.h>
 
+#include "rng.h"
+
 int randint(int min, int max) {
+    return randint_r(get_thread_rng(), min, max);
+}
+
+int randint_r(struct rng* rng, int min, int max) {
+    if (rng == NULL) return randint(min, max);
     if (min > max) return 0;
-    return min + rand() % (max - min + 1);
-}
\ No newline at end of file
+    return min + (int)get_rng_below(rng, (uint64_t)max - min + 1);
+}
@@ -1,6 +1,17 @@
 #ifndef CS303_HELPER_H
 #define CS303_HELPER_H
 
+#include "rng.h"
+
+/*
+Unbiased integer in [min, max] from the generator of the calling thread, 0 if min > max
+*/
 int randint(int min, int max);
 
-#endif
\ No newline at end of file
+/*
+Same as randint() but draws from `rng` instead of the generator of the calling thread
+Falls back to randint() if `rng` is NULL
+*/
+int randint_r(struct rng* rng, int min, int max);
+
+#endif
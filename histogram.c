@@ -0,0 +1,82 @@
+#include "histogram.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+void init_histogram(struct histogram* histogram) {
+    for (int i = 0; i < NUM_HISTOGRAM_BUCKETS; i++)
+        atomic_init(&histogram->counts[i], 0);
+    atomic_init(&histogram->total_count, 0);
+    atomic_init(&histogram->sum, 0);
+    atomic_init(&histogram->max, 0);
+}
+
+int get_histogram_bucket(long value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) return value;
+    int shift = (63 - __builtin_clzl(value)) - (HISTOGRAM_SUB_BUCKETS_LOG2 - 1);  // Keeps the top bits of `value` in [16, 32)
+    int sub_bucket = value >> shift;
+    return HISTOGRAM_SUB_BUCKETS + (shift - 1) * HISTOGRAM_HALF_SUB_BUCKETS + (sub_bucket - HISTOGRAM_HALF_SUB_BUCKETS);
+}
+
+long get_histogram_bucket_max_value(int bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) return bucket;
+    int shift = (bucket - HISTOGRAM_SUB_BUCKETS) / HISTOGRAM_HALF_SUB_BUCKETS + 1;
+    long sub_bucket = (bucket - HISTOGRAM_SUB_BUCKETS) % HISTOGRAM_HALF_SUB_BUCKETS + HISTOGRAM_HALF_SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void update_histogram_max(struct histogram* histogram, long value) {
+    long max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    while (value > max && !atomic_compare_exchange_weak_explicit(&histogram->max, &max, value, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+void record_histogram_value(struct histogram* histogram, long value) {
+    if (value < 0) value = 0;
+    atomic_fetch_add_explicit(&histogram->counts[get_histogram_bucket(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->sum, value, memory_order_relaxed);
+    update_histogram_max(histogram, value);
+}
+
+void merge_histogram(struct histogram* dst, struct histogram* src) {
+    for (int i = 0; i < NUM_HISTOGRAM_BUCKETS; i++) {
+        long count = atomic_load_explicit(&src->counts[i], memory_order_relaxed);
+        if (count != 0)
+            atomic_fetch_add_explicit(&dst->counts[i], count, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&dst->total_count, atomic_load_explicit(&src->total_count, memory_order_relaxed), memory_order_relaxed);
+    atomic_fetch_add_explicit(&dst->sum, atomic_load_explicit(&src->sum, memory_order_relaxed), memory_order_relaxed);
+    update_histogram_max(dst, atomic_load_explicit(&src->max, memory_order_relaxed));
+}
+
+long get_histogram_percentile(struct histogram* histogram, double percentile) {
+    long total_count = get_histogram_count(histogram);
+    if (total_count == 0) return 0;
+    long rank = (long)(percentile / 100.0 * total_count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total_count) rank = total_count;
+    long max = get_histogram_max(histogram);
+    long count = 0;
+    for (int i = 0; i < NUM_HISTOGRAM_BUCKETS; i++) {
+        count += atomic_load_explicit(&histogram->counts[i], memory_order_relaxed);
+        if (count >= rank) {
+            long value = get_histogram_bucket_max_value(i);
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
+
+long get_histogram_count(struct histogram* histogram) {
+    return atomic_load_explicit(&histogram->total_count, memory_order_relaxed);
+}
+
+long get_histogram_max(struct histogram* histogram) {
+    return atomic_load_explicit(&histogram->max, memory_order_relaxed);
+}
+
+double get_histogram_mean(struct histogram* histogram) {
+    long total_count = get_histogram_count(histogram);
+    return total_count == 0 ? 0 : (double)atomic_load_explicit(&histogram->sum, memory_order_relaxed) / total_count;
+}
@@ -0,0 +1,55 @@
+#ifndef CS303_HISTOGRAM_H
+#define CS303_HISTOGRAM_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#define HISTOGRAM_SUB_BUCKETS_LOG2 (5)
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKETS_LOG2)  // Values below this are counted exactly
+#define HISTOGRAM_HALF_SUB_BUCKETS (HISTOGRAM_SUB_BUCKETS / 2)
+#define NUM_HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS + (63 - HISTOGRAM_SUB_BUCKETS_LOG2) * HISTOGRAM_HALF_SUB_BUCKETS)  // Up to the largest long
+
+/*
+Log-bucketed histogram of non-negative values in the style of HdrHistogram
+Every power of two range is split linearly into 16 buckets, so a value is reported within 1/16 (6.25%) of itself
+Recording is lock-free, any number of threads may record into the same histogram
+*/
+struct histogram {
+    _Atomic long counts[NUM_HISTOGRAM_BUCKETS];
+    _Atomic long total_count;
+    _Atomic long sum;
+    _Atomic long max;
+};
+
+void init_histogram(struct histogram* histogram);
+
+int get_histogram_bucket(long value);
+
+/*
+Largest value counted in `bucket`
+*/
+long get_histogram_bucket_max_value(int bucket);
+
+/*
+Negative values are counted as 0
+*/
+void record_histogram_value(struct histogram* histogram, long value);
+
+/*
+Adds every value recorded in `src` to `dst`
+*/
+void merge_histogram(struct histogram* dst, struct histogram* src);
+
+/*
+Smallest recorded value that `percentile` percent of the values are at most, within the bucket precision
+        0 if nothing was recorded
+*/
+long get_histogram_percentile(struct histogram* histogram, double percentile);
+
+long get_histogram_count(struct histogram* histogram);
+
+long get_histogram_max(struct histogram* histogram);
+
+double get_histogram_mean(struct histogram* histogram);
+
+#endif
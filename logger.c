@@ -1,15 +1,43 @@
 #include "logger.h"
 
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#define LOG_WRITER_BATCH_SIZE (64 * 1024)
+#define LOG_WRITER_IDLE_NANOS (1000000)
+
 int __log_level__ = 0;
 int __log_level_backup__ = 0;
 FILE* __log_stream__ = NULL;
 
+struct log_record {
+    _Atomic long sequence;
+    int length;
+    char text[LOG_RECORD_SIZE];
+};
+
+/*
+Bounded multi-producer/single-consumer ring of formatted records
+Each slot carries a sequence number telling producers and the writer whose turn it is
+*/
+struct log_ring {
+    long mask;
+    struct log_record* records;
+    _Alignas(64) _Atomic long enqueue_position;
+    _Alignas(64) _Atomic long dequeue_position;
+    _Alignas(64) _Atomic long dropped_records;
+    _Atomic bool stopped;
+    pthread_t writer;
+};
+
+struct log_ring* __log_ring__ = NULL;
+
 void set_log_stream(FILE* stream) {
     __log_stream__ = stream;
 }
@@ -27,51 +55,183 @@ void unmute_logs() {
     __log_level__ = __log_level_backup__;
 }
 
-char* get_current_time_string() {
-    time_t rawtime;
-    time(&rawtime);
-    struct tm* t = localtime(&rawtime);
-    char* timestr = (char*)malloc(8 + 1);
-    sprintf(timestr, "%02d:%02d:%02d", t->tm_hour, t->tm_min, t->tm_sec);
-    return timestr;
+bool is_log_level_enabled(int log_level) {
+    return log_level >= __log_level__;
 }
 
-char* get_prefixed_format(int log_level, const char* fmt) {
-    char* timestr = get_current_time_string();
-    const int MAX_PREFIX_SIZE = 20;
-    char prefix[MAX_PREFIX_SIZE];
+/*
+Writes HH:MM:SS into `timestr`, the string is cached per thread and refreshed once a second
+*/
+void get_current_time_string(char* timestr) {
+    static __thread time_t cached_time = -1;
+    static __thread char cached_timestr[8 + 1];
+    time_t rawtime = time(NULL);
+    if (rawtime != cached_time) {
+        struct tm t;
+        localtime_r(&rawtime, &t);
+        snprintf(cached_timestr, sizeof(cached_timestr), "%02u:%02u:%02u", (unsigned)t.tm_hour % 100, (unsigned)t.tm_min % 100, (unsigned)t.tm_sec % 100);  // Unsigned, so every field is 2 digits
+        cached_time = rawtime;
+    }
+    memcpy(timestr, cached_timestr, sizeof(cached_timestr));
+}
+
+const char* get_log_level_label(int log_level) {
     switch (log_level) {
         case LOG_LEVEL_INFO:
-            sprintf(prefix, "INFO  %s:", timestr);
-            break;
+            return "INFO ";
         case LOG_LEVEL_WARNING:
-            sprintf(prefix, "WARN  %s:", timestr);
-            break;
+            return "WARN ";
         case LOG_LEVEL_DEBUG:
-            sprintf(prefix, "DEBUG %s:", timestr);
-            break;
+            return "DEBUG";
         case LOG_LEVEL_ERROR:
-            sprintf(prefix, "ERROR %s:", timestr);
-            break;
+            return "ERROR";
         case LOG_LEVEL_STAT:
-            sprintf(prefix, "STAT  %s:", timestr);
-            break;
+            return "STAT ";
         default:
-            break;
+            return "";
+    }
+}
+
+/*
+Formats a full log line into `buffer`, returns its length without the terminating null byte
+Lines longer than the buffer are truncated but keep their newline
+*/
+int format_log_record(char* buffer, int buffer_size, int log_level, const char* fmt, va_list args) {
+    char timestr[8 + 1];
+    get_current_time_string(timestr);
+    int length = snprintf(buffer, buffer_size, "%s %s: ", get_log_level_label(log_level), timestr);
+    int message_length = vsnprintf(buffer + length, buffer_size - length, fmt, args);
+    if (message_length > 0) length += message_length;
+    if (length > buffer_size - 2) length = buffer_size - 2;
+    buffer[length++] = '\n';
+    buffer[length] = '\0';
+    return length;
+}
+
+bool push_log_record(struct log_ring* ring, const char* text, int length) {
+    long position = atomic_load_explicit(&ring->enqueue_position, memory_order_relaxed);
+    struct log_record* record;
+    while (true) {
+        record = &ring->records[position & ring->mask];
+        long sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+        long diff = sequence - position;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&ring->dropped_records, 1, memory_order_relaxed);
+            return false;
+        } else {
+            position = atomic_load_explicit(&ring->enqueue_position, memory_order_relaxed);
+        }
+    }
+    memcpy(record->text, text, length);
+    record->length = length;
+    atomic_store_explicit(&record->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+/*
+Moves every published record into `batch` and writes the batch in one call
+Returns the number of records written
+*/
+int drain_log_ring(struct log_ring* ring, char* batch) {
+    int records = 0;
+    int batch_length = 0;
+    long position = atomic_load_explicit(&ring->dequeue_position, memory_order_relaxed);
+    while (true) {
+        struct log_record* record = &ring->records[position & ring->mask];
+        if (atomic_load_explicit(&record->sequence, memory_order_acquire) != position + 1) break;
+        if (batch_length + record->length > LOG_WRITER_BATCH_SIZE) {
+            fwrite(batch, 1, batch_length, __log_stream__);
+            batch_length = 0;
+        }
+        memcpy(batch + batch_length, record->text, record->length);
+        batch_length += record->length;
+        atomic_store_explicit(&record->sequence, position + ring->mask + 1, memory_order_release);
+        position++;
+        records++;
+        atomic_store_explicit(&ring->dequeue_position, position, memory_order_release);
+    }
+    if (batch_length > 0) {
+        fwrite(batch, 1, batch_length, __log_stream__);
+        fflush(__log_stream__);
     }
-    free(timestr);
-    char* new_fmt;
-    new_fmt = (char*)malloc(strlen(fmt) + MAX_PREFIX_SIZE + 2);
-    sprintf(new_fmt, "%s %s\n", prefix, fmt);
-    return new_fmt;
+    return records;
+}
+
+void* run_log_writer(void* args) {
+    struct log_ring* ring = (struct log_ring*)args;
+    char* batch = (char*)malloc(LOG_WRITER_BATCH_SIZE);
+    struct timespec idle = {0, LOG_WRITER_IDLE_NANOS};
+    while (true) {
+        bool stopped = atomic_load_explicit(&ring->stopped, memory_order_acquire);
+        if (drain_log_ring(ring, batch) == 0) {
+            if (stopped) break;
+            nanosleep(&idle, NULL);
+        }
+    }
+    free(batch);
+    return NULL;
+}
+
+void enable_async_logging(int capacity) {
+    if (__log_ring__ != NULL) return;
+    if (!__log_stream__) set_log_stream(stdout);
+    long slots = 1;
+    while (slots < capacity) slots *= 2;
+    struct log_ring* ring = (struct log_ring*)aligned_alloc(64, sizeof(struct log_ring));
+    ring->mask = slots - 1;
+    ring->records = (struct log_record*)malloc(slots * sizeof(struct log_record));
+    for (long i = 0; i < slots; i++)
+        atomic_init(&ring->records[i].sequence, i);
+    atomic_init(&ring->enqueue_position, 0);
+    atomic_init(&ring->dequeue_position, 0);
+    atomic_init(&ring->dropped_records, 0);
+    atomic_init(&ring->stopped, false);
+    pthread_create(&ring->writer, NULL, run_log_writer, ring);
+    __log_ring__ = ring;
+}
+
+void disable_async_logging() {
+    struct log_ring* ring = __log_ring__;
+    if (ring == NULL) return;
+    atomic_store_explicit(&ring->stopped, true, memory_order_release);
+    pthread_join(ring->writer, NULL);
+    __log_ring__ = NULL;
+    free(ring->records);
+    free(ring);
+}
+
+bool is_async_logging() {
+    return __log_ring__ != NULL;
+}
+
+void flush_logs() {
+    struct log_ring* ring = __log_ring__;
+    if (ring != NULL) {
+        struct timespec idle = {0, LOG_WRITER_IDLE_NANOS};
+        long position = atomic_load_explicit(&ring->enqueue_position, memory_order_acquire);
+        while (atomic_load_explicit(&ring->dequeue_position, memory_order_acquire) < position)
+            nanosleep(&idle, NULL);
+    }
+    if (__log_stream__) fflush(__log_stream__);
+}
+
+long get_dropped_log_count() {
+    return __log_ring__ == NULL ? 0 : atomic_load_explicit(&__log_ring__->dropped_records, memory_order_relaxed);
 }
 
 void console_log(int log_level, const char* fmt, va_list args) {
+    if (!is_log_level_enabled(log_level)) return;
     if (!__log_stream__) set_log_stream(stdout);
-    if (log_level < __log_level__) return;
-    char* new_fmt = get_prefixed_format(log_level, fmt);
-    vfprintf(__log_stream__, new_fmt, args);
-    free(new_fmt);
+    static __thread char buffer[LOG_RECORD_SIZE];
+    int length = format_log_record(buffer, LOG_RECORD_SIZE, log_level, fmt, args);
+    struct log_ring* ring = __log_ring__;
+    if (ring != NULL)
+        push_log_record(ring, buffer, length);
+    else
+        fwrite(buffer, 1, length, __log_stream__);
 }
 
 void log_debug(const char* fmt, ...) {
@@ -107,4 +267,4 @@ void log_stat(const char* fmt, ...) {
     va_start(args, fmt);
     console_log(LOG_LEVEL_STAT, fmt, args);
     va_end(args);
-}
\ No newline at end of file
+}
@@ -7,7 +7,11 @@
 #define LOG_LEVEL_ERROR (3)
 #define LOG_LEVEL_STAT (4)
 
+#define LOG_RECORD_SIZE (256)  // Longer log lines are truncated
+#define DEFAULT_ASYNC_LOG_CAPACITY (1 << 16)
+
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 extern int __log_level__;
@@ -22,6 +26,30 @@ void mute_logs();
 
 void unmute_logs();
 
+bool is_log_level_enabled(int log_level);
+
+/*
+Log calls format into a per-thread buffer and push the line onto a lock-free ring of `capacity` records
+A background writer thread drains the ring to the log stream in batches
+Lines are dropped, and counted, when the ring is full
+*/
+void enable_async_logging(int capacity);
+
+/*
+Writes every pending line and stops the writer thread, later log calls write synchronously
+Must not race with log calls from other threads
+*/
+void disable_async_logging();
+
+bool is_async_logging();
+
+/*
+Blocks until every line logged so far has reached the log stream
+*/
+void flush_logs();
+
+long get_dropped_log_count();
+
 void console_log(int log_level, const char* fmt, va_list args);
 
 void log_debug(const char* fmt, ...);
@@ -1,13 +1,76 @@
+#include <getopt.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "arrival.h"
+#include "backfill.h"
+#include "compaction.h"
 #include "ds.h"
+#include "event_simulator.h"
 #include "helper.h"
 #include "logger.h"
+#include "rng.h"
+#include "scheduling.h"
+#include "sharded_simulator.h"
 #include "simulator.h"
+#include "sweep.h"
+#include "trace.h"
+
+char* get_compaction_trigger_name(enum compaction_trigger trigger) {
+    switch (trigger) {
+        case COMPACTION_DISABLED:
+            return "None";
+            break;
+        case COMPACTION_ON_FAILURE:
+            return "On allocation failure";
+            break;
+        case COMPACTION_ON_FRAGMENTATION:
+            return "On fragmentation";
+            break;
+        case COMPACTION_PERIODIC:
+            return "Periodic";
+            break;
+    }
+    return "Unknown";
+}
+
+char* get_arrival_distribution_name(enum arrival_distribution distribution) {
+    switch (distribution) {
+        case ARRIVALS_POISSON:
+            return "Poisson";
+            break;
+        case ARRIVALS_BURSTY:
+            return "Bursty";
+            break;
+        case ARRIVALS_MMPP:
+            return "Markov-modulated Poisson";
+            break;
+    }
+    return "Unknown";
+}
+
+char* get_scheduling_policy_name(enum scheduling_policy policy) {
+    switch (policy) {
+        case SCHEDULE_FIFO:
+            return "First in, first out";
+            break;
+        case SCHEDULE_SHORTEST_JOB_FIRST:
+            return "Shortest job first";
+            break;
+        case SCHEDULE_SMALLEST_FIRST:
+            return "Smallest first";
+            break;
+        case SCHEDULE_PRIORITY_CLASSES:
+            return "Priority classes";
+            break;
+    }
+    return "Unknown";
+}
 
 char* get_algo_name_from_enum(enum placement_algo algo) {
     switch (algo) {
@@ -20,12 +83,258 @@ char* get_algo_name_from_enum(enum placement_algo algo) {
         case NEXT_FIT:
             return "Next fit";
             break;
+        case BUDDY:
+            return "Buddy system";
+            break;
+        case WORST_FIT:
+            return "Worst fit";
+            break;
+        case TLSF:
+            return "Two-level segregated fit";
+            break;
+        case BITMAP_FIRST_FIT:
+            return "Bitmap first fit";
+            break;
+        case BITMAP_BEST_FIT:
+            return "Bitmap best fit";
+            break;
+        case BITMAP_NEXT_FIT:
+            return "Bitmap next fit";
+            break;
+        case TABLE_FIRST_FIT:
+            return "Table first fit";
+            break;
+        case TABLE_BEST_FIT:
+            return "Table best fit";
+            break;
+        case TABLE_NEXT_FIT:
+            return "Table next fit";
+            break;
+        case TABLE_WORST_FIT:
+            return "Table worst fit";
+            break;
     }
     return "Unknown";
 }
 
+/*
+Reads one grid per line until EOF, empty lines and lines starting with '#' are skipped
+*/
+int run_sweep_from_stream(FILE* input, FILE* output, int num_threads, const char* replay_path, struct arrival_model* arrivals, struct block_layout* layout, struct compaction_policy* compaction) {
+    struct sweep* sweep = get_new_sweep();
+    sweep->replay_path = replay_path;
+    sweep->arrivals = *arrivals;
+    sweep->layout = *layout;
+    char* line = NULL;
+    size_t line_capacity = 0;
+    int line_number = 0;
+    while (getline(&line, &line_capacity, input) != -1) {
+        line_number++;
+        if (line[strspn(line, " \t\r\n")] == '\0' || line[0] == '#') continue;
+        if (!add_sweep_grid(sweep, line, compaction)) {
+            log_error("Line %d is not a valid grid of p, q, n, m, t, T, max queue size, placement algorithm, seed and optional scheduling policy", line_number);
+            free(line);
+            free_sweep(sweep);
+            return 1;
+        }
+    }
+    free(line);
+
+    run_sweep(sweep, num_threads);
+    write_sweep_csv(sweep, output);
+    free_sweep(sweep);
+    return 0;
+}
+
 int main(int argc, char** argv) {
-    srand(time(NULL));
+    uint64_t seed = time(NULL);  // Every random draw derives from it, pass the logged seed to reproduce a run
+    bool event_driven = false;  // Simulate on a virtual clock instead of wall-clock time
+    bool async_log = false;     // Write logs from a background thread
+    bool sweep_mode = false;    // Read a grid of configurations and run them in parallel
+    int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    char* replay_path = NULL;  // Trace to take arrivals from
+    char* record_path = NULL;  // Trace to write arrivals to
+    int num_shards = 0;        // Split memory into independently locked shards if positive
+    int num_allocators = 1;
+    enum shard_policy shard_policy = SHARD_ROUND_ROBIN;
+    enum scheduling_policy scheduling = SCHEDULE_FIFO;
+    bool backfill_enabled = false;  // Let queued processes overtake a head that does not fit
+    enum backfill_policy backfill_policy = BACKFILL_FIRST;
+    int backfill_limit = DEFAULT_BACKFILL_LIMIT;
+    struct arrival_model* arrivals = get_new_arrival_model(ARRIVALS_POISSON, 1, DEFAULT_MMPP_PEAK_FACTOR, DEFAULT_MMPP_DWELL_IN_MILLIS);
+    struct compaction_policy* compaction = get_new_compaction_policy(COMPACTION_DISABLED, 0, 0, DEFAULT_COMPACTION_BANDWIDTH);
+    struct block_layout layout;  // Alignment and minimum size of every partition in bytes
+    init_block_layout(&layout, DEFAULT_ALIGNMENT, DEFAULT_MIN_BLOCK_SIZE);
+
+    struct option long_options[] = {
+        {"event-driven", no_argument, NULL, 'e'},
+        {"async-log", no_argument, NULL, 'a'},
+        {"compaction", required_argument, NULL, 'c'},
+        {"compaction-bandwidth", required_argument, NULL, 'b'},
+        {"sweep", no_argument, NULL, 's'},
+        {"threads", required_argument, NULL, 'j'},
+        {"replay", required_argument, NULL, 'R'},
+        {"record", required_argument, NULL, 'W'},
+        {"shards", required_argument, NULL, 'S'},
+        {"allocators", required_argument, NULL, 'A'},
+        {"shard-policy", required_argument, NULL, 'P'},
+        {"schedule", required_argument, NULL, 'Q'},
+        {"backfill", required_argument, NULL, 'B'},
+        {"backfill-limit", required_argument, NULL, 'L'},
+        {"seed", required_argument, NULL, 'x'},
+        {"arrivals", required_argument, NULL, 'I'},
+        {"alignment", required_argument, NULL, 'G'},
+        {"min-block-size", required_argument, NULL, 'K'},
+        {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "eac:b:sj:R:W:S:A:P:Q:B:L:x:I:G:K:", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'e':
+                event_driven = true;
+                break;
+            case 'a':
+                async_log = true;
+                break;
+            case 'c':
+                if (!parse_compaction_trigger(optarg, compaction)) {
+                    log_error("Compaction should be either none, failure, fragmentation:<percentage>, or periodic:<millis>, got %s", optarg);
+                    return 1;
+                }
+                break;
+            case 'b':
+                compaction->bandwidth = atoi(optarg);
+                if (compaction->bandwidth <= 0) {
+                    log_error("Compaction bandwidth should be positive integer, got %s", optarg);
+                    return 1;
+                }
+                break;
+            case 's':
+                sweep_mode = true;
+                break;
+            case 'j':
+                num_threads = atoi(optarg);
+                if (num_threads <= 0) {
+                    log_error("Number of threads should be positive integer, got %s", optarg);
+                    return 1;
+                }
+                break;
+            case 'R':
+                replay_path = optarg;
+                break;
+            case 'W':
+                record_path = optarg;
+                break;
+            case 'S':
+                num_shards = atoi(optarg);
+                if (num_shards <= 0) {
+                    log_error("Number of shards should be positive integer, got %s", optarg);
+                    return 1;
+                }
+                break;
+            case 'A':
+                num_allocators = atoi(optarg);
+                if (num_allocators <= 0) {
+                    log_error("Number of allocators should be positive integer, got %s", optarg);
+                    return 1;
+                }
+                break;
+            case 'P':
+                if (strcmp(optarg, "round-robin") == 0) {
+                    shard_policy = SHARD_ROUND_ROBIN;
+                } else if (strcmp(optarg, "least-loaded") == 0) {
+                    shard_policy = SHARD_LEAST_LOADED;
+                } else if (strcmp(optarg, "size-affinity") == 0) {
+                    shard_policy = SHARD_SIZE_AFFINITY;
+                } else {
+                    log_error("Shard policy should be either round-robin, least-loaded, or size-affinity, got %s", optarg);
+                    return 1;
+                }
+                break;
+            case 'Q':
+                if (!parse_scheduling_policy(optarg, &scheduling)) {
+                    log_error("Scheduling policy should be either fifo, sjf, smallest, or priority, got %s", optarg);
+                    return 1;
+                }
+                break;
+            case 'B':
+                backfill_enabled = true;
+                if (strcmp(optarg, "first") == 0) {
+                    backfill_policy = BACKFILL_FIRST;
+                } else if (strcmp(optarg, "best") == 0) {
+                    backfill_policy = BACKFILL_BEST;
+                } else {
+                    log_error("Backfill policy should be either first or best, got %s", optarg);
+                    return 1;
+                }
+                break;
+            case 'L':
+                backfill_limit = atoi(optarg);
+                if (backfill_limit < 0) {
+                    log_error("Backfill limit should be non-negative integer, got %s", optarg);
+                    return 1;
+                }
+                break;
+            case 'x':
+                if (optarg[0] == '\0' || optarg[strspn(optarg, "0123456789")] != '\0') {
+                    log_error("Seed should be non-negative integer, got %s", optarg);
+                    return 1;
+                }
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'I':
+                if (!parse_arrival_model(optarg, arrivals)) {
+                    log_error("Arrivals should be either poisson, bursty:<mean batch size>, or mmpp[:<peak factor between 1 and 2>], got %s", optarg);
+                    return 1;
+                }
+                break;
+            case 'G':
+                layout.alignment = strtoull(optarg, NULL, 10);
+                if (optarg[strspn(optarg, "0123456789")] != '\0' || layout.alignment == 0 || (layout.alignment & (layout.alignment - 1)) != 0) {
+                    log_error("Alignment should be a power of two in bytes, got %s", optarg);
+                    return 1;
+                }
+                break;
+            case 'K':
+                layout.min_block_size = strtoull(optarg, NULL, 10);
+                if (optarg[strspn(optarg, "0123456789")] != '\0' || layout.min_block_size == 0) {
+                    log_error("Minimum block size should be positive integer in bytes, got %s", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                return 1;
+        }
+    }
+
+    if ((num_shards > 0 || num_allocators > 1) && (event_driven || sweep_mode || compaction->trigger != COMPACTION_DISABLED)) {
+        log_error("Shards and multiple allocators only run in real time and without compaction");
+        return 1;
+    }
+
+    if (backfill_enabled && (num_shards > 0 || num_allocators > 1 || sweep_mode || scheduling != SCHEDULE_FIFO)) {
+        log_error("Backfilling only runs with a single allocator, FIFO scheduling and outside of a sweep");
+        return 1;
+    }
+
+    if (sweep_mode) {
+        if (scheduling != SCHEDULE_FIFO) {
+            log_error("A sweep takes the scheduling policy from its grid");
+            return 1;
+        }
+        if (record_path != NULL) {
+            log_error("A sweep can not record a trace, record one simulation and replay it in the sweep instead");
+            return 1;
+        }
+        struct trace_reader* replay = replay_path != NULL ? open_trace_reader(replay_path) : NULL;
+        if (replay_path != NULL && replay == NULL) {
+            log_error("Could not open trace \"%s\" for replay", replay_path);
+            return 1;
+        }
+        if (replay != NULL) {
+            close_trace_reader(replay);
+        }
+        return run_sweep_from_stream(stdin, stdout, num_threads, replay_path, arrivals, &layout, compaction);
+    }
 
     int p = 1000;  // Total main memory
     int q = 200;   // Memory reserved for OS
@@ -53,8 +362,19 @@ int main(int argc, char** argv) {
         log_error("Maximum queue size should be positive integer, got %d", MAX_QUEUE_SIZE);
         error = true;
     }
-    if (algo != FIRST_FIT && algo != BEST_FIT && algo != NEXT_FIT) {
-        log_error("Placement algorithm should be either 0 (first fit), 1 (best fit), or 2 (next fit), got %d", algo);
+    if (algo < FIRST_FIT || algo > TABLE_WORST_FIT) {
+        log_error("Placement algorithm should be either 0 (first fit), 1 (best fit), 2 (next fit), 3 (buddy system), 4 (worst fit), 5 (two-level segregated fit), 6 (bitmap first fit), 7 (bitmap best fit), 8 (bitmap next fit), 9 (table first fit), 10 (table best fit), 11 (table next fit), or 12 (table worst fit), got %d", algo);
+        error = true;
+    }
+
+    struct trace_reader* replay = NULL;
+    if (replay_path != NULL && (replay = open_trace_reader(replay_path)) == NULL) {
+        log_error("Could not open trace \"%s\" for replay", replay_path);
+        error = true;
+    }
+    struct trace_writer* record = NULL;
+    if (record_path != NULL && (record = open_trace_writer(record_path)) == NULL) {
+        log_error("Could not create trace \"%s\"", record_path);
         error = true;
     }
 
@@ -62,7 +382,14 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    float r = randint(0.1 * n * 1e4, 1.2 * n * 1e4) / 1e4;  // Number of process spawing per second
+    if (async_log) {
+        enable_async_logging(DEFAULT_ASYNC_LOG_CAPACITY);
+    }
+
+    seed_thread_rngs(seed);
+    struct rng rng;
+    seed_rng(&rng, seed);
+    float r = get_random_arrival_rate(n, &rng);  // Number of process spawing per second
 
     log_info("RUNNING SIMULATION WITH FOLLOWING CONFIG");
     log_info("p: %dMB", p);
@@ -72,13 +399,45 @@ int main(int argc, char** argv) {
     log_info("t: %dsec", t);
     log_info("T: %dmin", T);
     log_info("r: %.2f", r);
+    log_info("Seed: %llu", (unsigned long long)seed);
+    log_info("Arrivals: %s", get_arrival_distribution_name(arrivals->distribution));
     log_info("Algo: %s", get_algo_name_from_enum(algo));
+    log_info("Alignment: %luB, Minimum block size: %luB", layout.alignment, layout.min_block_size);
+    log_info("Mode: %s", event_driven ? "Event-driven" : "Real time");
+    log_info("Compaction: %s", get_compaction_trigger_name(compaction->trigger));
+    log_info("Scheduling: %s", get_scheduling_policy_name(scheduling));
+    if (backfill_enabled) {
+        log_info("Backfill: %s fit, head reserved after %d bypasses", backfill_policy == BACKFILL_FIRST ? "First" : "Best", backfill_limit);
+    }
+    if (replay != NULL) {
+        log_info("Replaying %ld processes from %s", replay->num_records, replay_path);
+    }
+
+    if (num_shards > 0 || num_allocators > 1) {
+        log_info("Shards: %d, Allocators: %d", num_shards > 0 ? num_shards : 1, num_allocators);
+    }
+
+    struct backfill_scheduler* backfill = backfill_enabled ? get_new_backfill_scheduler(backfill_policy, backfill_limit) : NULL;
 
-    run(p, q, n, m, t, r, algo, MAX_QUEUE_SIZE, stat);
-    sleep(T * 60);
+    if (event_driven) {
+        run_event_driven(p, q, m, t, r, arrivals, algo, &layout, MAX_QUEUE_SIZE, T, next_rng(&rng), replay, record, scheduling, backfill, compaction, stat);
+    } else if (num_shards > 0 || num_allocators > 1) {
+        run_sharded(p, q, m, t, r, arrivals, algo, &layout, MAX_QUEUE_SIZE, num_shards > 0 ? num_shards : 1, num_allocators, shard_policy, scheduling, replay, record, stat);
+        sleep(T * 60);
+    } else {
+        run(p, q, m, t, r, arrivals, algo, &layout, MAX_QUEUE_SIZE, replay, record, scheduling, backfill, compaction, stat);
+        sleep(T * 60);
+    }
+
+    if (record != NULL) {
+        close_trace_writer(record);
+        log_info("Recorded %ld processes to %s", record->records, record_path);
+    }
 
-    float avg_turnaround_time = (stat->turnaround_time_den == 0 ? 0 : (1.0f * stat->turnaround_time_num) / stat->turnaround_time_den);
-    float avg_mem_util = (stat->memory_utilization_den == 0 ? 0 : (stat->memory_utilization_num / stat->memory_utilization_den));
-    log_stat("Avg. turnaround time: %.2fms, Avg. memory util: %.2f%", avg_turnaround_time, avg_mem_util);
+    log_stats(stat);
+    if (async_log) {
+        log_stat("Dropped log lines: %ld", get_dropped_log_count());
+    }
+    flush_logs();
     return 0;
 }
\ No newline at end of file
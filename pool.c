@@ -0,0 +1,64 @@
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define POOL_ALIGNMENT (16)
+
+size_t round_up_to_alignment(size_t size) {
+    return (size + POOL_ALIGNMENT - 1) / POOL_ALIGNMENT * POOL_ALIGNMENT;
+}
+
+struct object_pool* get_new_object_pool(size_t object_size, int objects_per_chunk, bool synchronized) {
+    struct object_pool* pool = (struct object_pool*)malloc(sizeof(struct object_pool));
+    pool->object_size = round_up_to_alignment(object_size < sizeof(void*) ? sizeof(void*) : object_size);
+    pool->objects_per_chunk = objects_per_chunk;
+    pool->synchronized = synchronized;
+    pool->free_list = NULL;
+    pool->chunks = NULL;
+    pthread_mutex_init(&pool->mutex, NULL);
+    return pool;
+}
+
+void grow_object_pool(struct object_pool* pool) {
+    size_t header_size = round_up_to_alignment(sizeof(struct object_pool_chunk));
+    struct object_pool_chunk* chunk = (struct object_pool_chunk*)malloc(header_size + pool->object_size * pool->objects_per_chunk);
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+    char* objects = (char*)chunk + header_size;
+    for (int i = pool->objects_per_chunk - 1; i >= 0; i--) {
+        void** object = (void**)(objects + i * pool->object_size);
+        *object = pool->free_list;
+        pool->free_list = object;
+    }
+}
+
+void* pool_alloc(struct object_pool* pool) {
+    if (pool->synchronized) pthread_mutex_lock(&pool->mutex);
+    if (pool->free_list == NULL)
+        grow_object_pool(pool);
+    void** object = (void**)pool->free_list;
+    pool->free_list = *object;
+    if (pool->synchronized) pthread_mutex_unlock(&pool->mutex);
+    return object;
+}
+
+void pool_free(struct object_pool* pool, void* object) {
+    if (pool->synchronized) pthread_mutex_lock(&pool->mutex);
+    *(void**)object = pool->free_list;
+    pool->free_list = object;
+    if (pool->synchronized) pthread_mutex_unlock(&pool->mutex);
+}
+
+void free_object_pool(struct object_pool* pool) {
+    struct object_pool_chunk* chunk = pool->chunks;
+    while (chunk != NULL) {
+        struct object_pool_chunk* chunk_to_free = chunk;
+        chunk = chunk->next;
+        free(chunk_to_free);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
@@ -0,0 +1,39 @@
+#ifndef CS303_POOL_H
+#define CS303_POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct object_pool_chunk {
+    struct object_pool_chunk* next;
+};
+
+/*
+Fixed-size object allocator
+Objects are carved out of chunks, a free object stores the pointer to the next free object in its first word
+*/
+struct object_pool {
+    size_t object_size;
+    int objects_per_chunk;
+    bool synchronized;  // Whether `mutex` guards alloc and free
+    void* free_list;
+    struct object_pool_chunk* chunks;
+    pthread_mutex_t mutex;
+};
+
+/*
+`synchronized` must be true if objects may be allocated or freed from several threads without an external lock
+*/
+struct object_pool* get_new_object_pool(size_t object_size, int objects_per_chunk, bool synchronized);
+
+void* pool_alloc(struct object_pool* pool);
+
+void pool_free(struct object_pool* pool, void* object);
+
+/*
+Releases every chunk of the pool at once, objects still in use become invalid
+*/
+void free_object_pool(struct object_pool* pool);
+
+#endif
@@ -0,0 +1,162 @@
+/*
+malloc() family served by an arena, build with `make lib` and load with LD_PRELOAD=build/libcs303malloc.so
+CS303_MALLOC_ALGO picks first, best, next, worst, or tlsf (default best, first fit scans every free partition)
+CS303_MALLOC_ARENA_MB sets the reserved address space (default 4096)
+Nothing here may call the C library allocator, it would re-enter these functions
+*/
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arena.h"
+
+#define PRELOAD_EXPORT __attribute__((visibility("default")))  // The library is built with hidden visibility
+
+static struct arena arena;
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+static bool is_arena_ready = false;
+
+static void log_preload_error(const char* message) {
+    ssize_t written = write(STDERR_FILENO, message, strlen(message));
+    (void)written;
+}
+
+static void lock_arena() {
+    pthread_mutex_lock(&arena.mutex);
+}
+
+static void unlock_arena() {
+    pthread_mutex_unlock(&arena.mutex);
+}
+
+static void init_preloaded_arena() {
+    enum placement_algo algo = BEST_FIT;
+    const char* algo_name = getenv("CS303_MALLOC_ALGO");
+    if (algo_name != NULL && !parse_arena_algo(algo_name, &algo))
+        log_preload_error("cs303malloc: CS303_MALLOC_ALGO should be either first, best, next, worst, or tlsf, using best\n");
+    uint64_t size = DEFAULT_ARENA_SIZE;
+    const char* size_in_mb = getenv("CS303_MALLOC_ARENA_MB");
+    if (size_in_mb != NULL) {
+        unsigned long long parsed = strtoull(size_in_mb, NULL, 10);
+        if (parsed > 0 && parsed < MAX_MEMORY_SIZE / BYTES_PER_MB)
+            size = parsed * BYTES_PER_MB;
+        else
+            log_preload_error("cs303malloc: CS303_MALLOC_ARENA_MB should be a positive integer, using 4096\n");
+    }
+    if (!init_arena(&arena, size, algo)) {
+        log_preload_error("cs303malloc: could not map the arena\n");
+        return;
+    }
+    is_arena_ready = true;
+}
+
+static bool ensure_arena() {
+    pthread_once(&arena_once, init_preloaded_arena);
+    return is_arena_ready;
+}
+
+/*
+Keeps the arena consistent across fork(), the child must not inherit a mutex held by another thread
+*/
+__attribute__((constructor)) static void register_fork_handlers() {
+    if (ensure_arena())
+        pthread_atfork(lock_arena, unlock_arena, unlock_arena);
+}
+
+PRELOAD_EXPORT void* malloc(size_t size) {
+    void* ptr = ensure_arena() ? arena_alloc(&arena, size) : NULL;
+    if (ptr == NULL)
+        errno = ENOMEM;
+    return ptr;
+}
+
+PRELOAD_EXPORT void free(void* ptr) {
+    if (ptr != NULL && is_arena_ready && is_in_arena(&arena, ptr))
+        arena_free(&arena, ptr);
+}
+
+PRELOAD_EXPORT void* calloc(size_t count, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(count, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    // Not malloc() followed by memset(), the compiler would fold that pair back into a call to calloc()
+    void* ptr = ensure_arena() ? arena_alloc(&arena, total) : NULL;
+    if (ptr == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memset(ptr, 0, total);
+    return ptr;
+}
+
+PRELOAD_EXPORT void* realloc(void* ptr, size_t size) {
+    if (ptr != NULL && size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    if (ptr == NULL)
+        return malloc(size);
+    if (!is_arena_ready || !is_in_arena(&arena, ptr)) {
+        // The size of a block from another allocator is unknown, so it can not be moved into the arena
+        log_preload_error("cs303malloc: realloc() of a pointer the arena did not allocate\n");
+        abort();
+    }
+    void* moved = arena_realloc(&arena, ptr, size);
+    if (moved == NULL)
+        errno = ENOMEM;
+    return moved;
+}
+
+PRELOAD_EXPORT void* reallocarray(void* ptr, size_t count, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(count, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(ptr, total);
+}
+
+PRELOAD_EXPORT int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    void* aligned = ensure_arena() ? arena_alloc_aligned(&arena, alignment, size) : NULL;
+    if (aligned == NULL)
+        return ENOMEM;
+    *ptr = aligned;
+    return 0;
+}
+
+PRELOAD_EXPORT void* aligned_alloc(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    void* ptr = ensure_arena() ? arena_alloc_aligned(&arena, alignment, size) : NULL;
+    if (ptr == NULL)
+        errno = ENOMEM;
+    return ptr;
+}
+
+PRELOAD_EXPORT void* memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+PRELOAD_EXPORT void* valloc(size_t size) {
+    return aligned_alloc((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+PRELOAD_EXPORT void* pvalloc(size_t size) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    return aligned_alloc(page_size, (size + page_size - 1) & ~(page_size - 1));
+}
+
+PRELOAD_EXPORT size_t malloc_usable_size(void* ptr) {
+    if (ptr == NULL || !is_arena_ready || !is_in_arena(&arena, ptr))
+        return 0;
+    return get_arena_usable_size(ptr);
+}
@@ -0,0 +1,85 @@
+#include "rng.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+static _Atomic uint64_t thread_rng_seed = 0;
+static _Atomic uint64_t seeded_thread_rngs = 0;  // Number of threads that have drawn so far
+static __thread struct rng thread_rng;
+static __thread bool is_thread_rng_seeded = false;
+
+uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void seed_rng(struct rng* rng, uint64_t seed) {
+    for (int i = 0; i < 4; i++)
+        rng->s[i] = splitmix64(&seed);
+}
+
+uint64_t rotate_left(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+uint64_t next_rng(struct rng* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rotate_left(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotate_left(s[3], 45);
+    return result;
+}
+
+uint64_t get_rng_below(struct rng* rng, uint64_t bound) {
+    if (bound == 0) return 0;
+    // Lemire's multiply-and-shift, redrawing the few values that would favour the low results
+    unsigned __int128 product = (unsigned __int128)next_rng(rng) * bound;
+    uint64_t low = (uint64_t)product;
+    if (low < bound) {
+        uint64_t threshold = -bound % bound;
+        while (low < threshold) {
+            product = (unsigned __int128)next_rng(rng) * bound;
+            low = (uint64_t)product;
+        }
+    }
+    return product >> 64;
+}
+
+double get_rng_uniform(struct rng* rng) {
+    return (next_rng(rng) >> 11) * 0x1.0p-53;
+}
+
+double get_rng_exponential(struct rng* rng, double rate) {
+    return -log1p(-get_rng_uniform(rng)) / rate;
+}
+
+double get_rng_lognormal(struct rng* rng, double mu, double sigma) {
+    // Box-Muller, 1 - u keeps the logarithm away from 0
+    double u = 1.0 - get_rng_uniform(rng);
+    double v = get_rng_uniform(rng);
+    double normal = sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+    return exp(mu + sigma * normal);
+}
+
+void seed_thread_rngs(uint64_t seed) {
+    atomic_store(&thread_rng_seed, seed);
+    atomic_store(&seeded_thread_rngs, 0);
+}
+
+struct rng* get_thread_rng() {
+    if (!is_thread_rng_seeded) {
+        uint64_t state = atomic_load(&thread_rng_seed) + atomic_fetch_add(&seeded_thread_rngs, 1);
+        seed_rng(&thread_rng, splitmix64(&state));
+        is_thread_rng_seeded = true;
+    }
+    return &thread_rng;
+}
@@ -0,0 +1,49 @@
+#ifndef CS303_RNG_H
+#define CS303_RNG_H
+
+#include <stdint.h>
+
+/*
+xoshiro256** generator, 32 bytes of state that only its owner touches
+Seeding goes through splitmix64, so nearby seeds give unrelated streams
+*/
+struct rng {
+    uint64_t s[4];
+};
+
+void seed_rng(struct rng* rng, uint64_t seed);
+
+uint64_t next_rng(struct rng* rng);
+
+/*
+Unbiased integer in [0, bound), 0 if `bound` is 0
+*/
+uint64_t get_rng_below(struct rng* rng, uint64_t bound);
+
+/*
+Uniform double in [0, 1) with 53 random bits
+*/
+double get_rng_uniform(struct rng* rng);
+
+/*
+Exponentially distributed with mean 1 / `rate`
+*/
+double get_rng_exponential(struct rng* rng, double rate);
+
+/*
+exp(N(`mu`, `sigma`^2))
+*/
+double get_rng_lognormal(struct rng* rng, double mu, double sigma);
+
+/*
+Seeds the generators of every thread that has not drawn a number yet
+The n-th thread to draw gets a stream derived from `seed` and n
+*/
+void seed_thread_rngs(uint64_t seed);
+
+/*
+Generator of the calling thread
+*/
+struct rng* get_thread_rng();
+
+#endif
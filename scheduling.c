@@ -0,0 +1,81 @@
+#include "scheduling.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ds.h"
+#include "heap.h"
+
+struct process_scheduler* get_new_process_scheduler(struct process_queue* queue, enum scheduling_policy policy) {
+    struct process_scheduler* scheduler = (struct process_scheduler*)malloc(sizeof(struct process_scheduler));
+    scheduler->policy = policy;
+    scheduler->queue = queue;
+    scheduler->ready = policy == SCHEDULE_FIFO ? NULL : get_new_min_heap(queue->max_size);
+    return scheduler;
+}
+
+bool parse_scheduling_policy(const char* name, enum scheduling_policy* policy) {
+    if (strcmp(name, "fifo") == 0) {
+        *policy = SCHEDULE_FIFO;
+    } else if (strcmp(name, "sjf") == 0) {
+        *policy = SCHEDULE_SHORTEST_JOB_FIRST;
+    } else if (strcmp(name, "smallest") == 0) {
+        *policy = SCHEDULE_SMALLEST_FIRST;
+    } else if (strcmp(name, "priority") == 0) {
+        *policy = SCHEDULE_PRIORITY_CLASSES;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+long get_scheduling_key(enum scheduling_policy policy, struct process* proc) {
+    switch (policy) {
+        case SCHEDULE_SHORTEST_JOB_FIRST:
+            return proc->d;
+        case SCHEDULE_SMALLEST_FIRST:
+            return proc->s;
+        case SCHEDULE_PRIORITY_CLASSES:
+            return proc->d > 0 ? 31 - __builtin_clz(proc->d) : 0;
+        default:
+            return 0;
+    }
+}
+
+/*
+Moves the processes enqueued since the last call into the heap
+The first `ready->size` queued processes are already in it, as each dequeue releases one slot and pops one process
+*/
+void admit_arrivals(struct process_scheduler* scheduler) {
+    int size = get_queue_size(scheduler->queue);
+    for (int offset = scheduler->ready->size; offset < size; offset++) {
+        struct process* proc = peek_queue_at(scheduler->queue, offset);
+        heap_push(scheduler->ready, get_scheduling_key(scheduler->policy, proc), proc);
+    }
+}
+
+bool has_scheduled_process(struct process_scheduler* scheduler) {
+    return !is_queue_empty(scheduler->queue);
+}
+
+struct process* peek_scheduled_process(struct process_scheduler* scheduler) {
+    if (scheduler->ready == NULL) return peek_queue(scheduler->queue);
+    admit_arrivals(scheduler);
+    return (struct process*)heap_peek(scheduler->ready, NULL);
+}
+
+struct process* dequeue_scheduled_process(struct process_scheduler* scheduler) {
+    if (scheduler->ready == NULL) return dequeue(scheduler->queue);
+    admit_arrivals(scheduler);
+    struct process* proc = (struct process*)heap_pop(scheduler->ready, NULL);
+    if (proc != NULL)
+        dequeue(scheduler->queue);  // Releases a slot, the process in it is already in the heap
+    return proc;
+}
+
+void free_process_scheduler(struct process_scheduler* scheduler) {
+    if (scheduler->ready != NULL)
+        free_min_heap(scheduler->ready);
+    free(scheduler);
+}
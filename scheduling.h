@@ -0,0 +1,53 @@
+#ifndef CS303_SCHEDULING_H
+#define CS303_SCHEDULING_H
+
+#include <stdbool.h>
+
+#include "ds.h"
+#include "heap.h"
+
+enum scheduling_policy {
+    SCHEDULE_FIFO = 0,                // Arrival order
+    SCHEDULE_SHORTEST_JOB_FIRST = 1,  // Smallest duration first
+    SCHEDULE_SMALLEST_FIRST = 2,      // Smallest size first
+    SCHEDULE_PRIORITY_CLASSES = 3     // Shorter duration classes of floor(log2(d)) first, arrival order within a class
+};
+
+/*
+Consumer side of a process queue that hands out the queued processes in the order of `policy`
+FIFO reads the queue directly, the other policies move new arrivals into a min-heap keyed by the policy
+A process keeps its queue slot until it is dequeued, so the queue still bounds the number of waiting processes
+Every dequeue of the queue must go through dequeue_scheduled_process()
+*/
+struct process_scheduler {
+    enum scheduling_policy policy;
+    struct process_queue* queue;
+    struct min_heap* ready;  // Admitted processes, NULL for FIFO
+};
+
+struct process_scheduler* get_new_process_scheduler(struct process_queue* queue, enum scheduling_policy policy);
+
+/*
+Parses "fifo", "sjf", "smallest" or "priority" into `policy`
+Returns false if `name` is none of them
+*/
+bool parse_scheduling_policy(const char* name, enum scheduling_policy* policy);
+
+/*
+Key a process is ordered by under `policy`, smaller keys go first
+*/
+long get_scheduling_key(enum scheduling_policy policy, struct process* proc);
+
+bool has_scheduled_process(struct process_scheduler* scheduler);
+
+/*
+Returns the process to allocate next without dequeuing it
+        NULL if no process is queued
+*/
+struct process* peek_scheduled_process(struct process_scheduler* scheduler);
+
+struct process* dequeue_scheduled_process(struct process_scheduler* scheduler);
+
+void free_process_scheduler(struct process_scheduler* scheduler);
+
+#endif
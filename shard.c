@@ -0,0 +1,158 @@
+#include "shard.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "ds.h"
+#include "simulator.h"
+
+struct sharded_memory* get_new_sharded_memory(uint64_t p, uint64_t q, int num_shards, enum placement_algo algo, struct block_layout* layout, enum shard_policy policy, uint64_t max_process_size) {
+    struct sharded_memory* sharded = (struct sharded_memory*)malloc(sizeof(struct sharded_memory));
+    sharded->p = p;
+    sharded->q = q;
+    sharded->num_shards = num_shards;
+    sharded->policy = policy;
+    sharded->algo = algo;
+    sharded->max_process_size = max_process_size;
+    atomic_init(&sharded->next_shard, 0);
+    atomic_init(&sharded->frees, 0);
+    pthread_mutex_init(&sharded->available_mutex, NULL);
+    pthread_cond_init(&sharded->available, NULL);
+
+    sharded->shards = (struct memory_shard*)malloc(num_shards * sizeof(struct memory_shard));
+    uint64_t alignment = layout != NULL ? layout->alignment : DEFAULT_ALIGNMENT;
+    uint64_t usable_blocks = (p - q) / alignment;
+    uint64_t base_address = 0;
+    for (int i = 0; i < num_shards; i++) {
+        struct memory_shard* shard = &sharded->shards[i];
+        uint64_t size = (usable_blocks / num_shards + ((uint64_t)i < usable_blocks % num_shards ? 1 : 0)) * alignment;
+        shard->mem = get_new_memory_for_algo(size, 0, algo, layout);
+        shard->base_address = base_address;
+        pthread_mutex_init(&shard->mutex, NULL);
+        atomic_init(&shard->used_size, 0);
+        atomic_init(&shard->requested_size, 0);
+        atomic_init(&shard->padding_size, 0);
+        base_address += size;
+    }
+    return sharded;
+}
+
+int select_shard(struct sharded_memory* sharded, uint64_t size) {
+    switch (sharded->policy) {
+        case SHARD_ROUND_ROBIN:
+            return atomic_fetch_add_explicit(&sharded->next_shard, 1, memory_order_relaxed) % sharded->num_shards;
+        case SHARD_LEAST_LOADED: {
+            int least_loaded = 0;
+            uint64_t most_free = 0;
+            for (int i = 0; i < sharded->num_shards; i++) {
+                struct memory_shard* shard = &sharded->shards[i];
+                uint64_t free_size = shard->mem->p - shard->mem->q - atomic_load_explicit(&shard->used_size, memory_order_relaxed);
+                if (i == 0 || free_size > most_free) {
+                    most_free = free_size;
+                    least_loaded = i;
+                }
+            }
+            return least_loaded;
+        }
+        case SHARD_SIZE_AFFINITY: {
+            if (sharded->max_process_size <= 0) return 0;
+            long shard = (long)((double)size * sharded->num_shards / (sharded->max_process_size + 1));
+            return shard < sharded->num_shards ? shard : sharded->num_shards - 1;
+        }
+    }
+    return 0;
+}
+
+struct partition* allocate_from_shards(struct sharded_memory* sharded, struct process* proc) {
+    int first_shard = select_shard(sharded, proc->s);
+    for (int i = 0; i < sharded->num_shards; i++) {
+        struct memory_shard* shard = &sharded->shards[(first_shard + i) % sharded->num_shards];
+        if (shard->mem->p - shard->mem->q - atomic_load_explicit(&shard->used_size, memory_order_relaxed) < get_block_size(shard->mem, proc->s))
+            continue;  // Can not fit, skip the lock
+        pthread_mutex_lock(&shard->mutex);
+        struct partition* part = allocate(shard->mem, proc, sharded->algo);
+        if (part != NULL) {
+            atomic_store_explicit(&shard->used_size, shard->mem->used_size, memory_order_relaxed);
+            atomic_store_explicit(&shard->requested_size, shard->mem->requested_size, memory_order_relaxed);
+            atomic_store_explicit(&shard->padding_size, shard->mem->padding_size, memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&shard->mutex);
+        if (part != NULL)
+            return part;
+    }
+    return NULL;
+}
+
+struct memory_shard* get_shard_of_partition(struct sharded_memory* sharded, struct partition* part) {
+    for (int i = 0; i < sharded->num_shards; i++) {
+        if (sharded->shards[i].mem == part->mem)
+            return &sharded->shards[i];
+    }
+    return NULL;
+}
+
+void deallocate_from_shards(struct sharded_memory* sharded, struct partition* part) {
+    struct memory_shard* shard = get_shard_of_partition(sharded, part);
+    pthread_mutex_lock(&shard->mutex);
+    deallocate_partition(part);
+    atomic_store_explicit(&shard->used_size, shard->mem->used_size, memory_order_relaxed);
+    atomic_store_explicit(&shard->requested_size, shard->mem->requested_size, memory_order_relaxed);
+    atomic_store_explicit(&shard->padding_size, shard->mem->padding_size, memory_order_relaxed);
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+void notify_shard_frees(struct sharded_memory* sharded) {
+    pthread_mutex_lock(&sharded->available_mutex);
+    atomic_fetch_add(&sharded->frees, 1);
+    pthread_cond_broadcast(&sharded->available);
+    pthread_mutex_unlock(&sharded->available_mutex);
+}
+
+void wait_for_shard_frees(struct sharded_memory* sharded, long frees) {
+    pthread_mutex_lock(&sharded->available_mutex);
+    while (atomic_load(&sharded->frees) == frees)
+        pthread_cond_wait(&sharded->available, &sharded->available_mutex);
+    pthread_mutex_unlock(&sharded->available_mutex);
+}
+
+float get_sharded_memory_utilization(struct sharded_memory* sharded) {
+    uint64_t used_size = sharded->q;
+    for (int i = 0; i < sharded->num_shards; i++)
+        used_size += atomic_load_explicit(&sharded->shards[i].used_size, memory_order_relaxed);
+    return (float)(100.0 * used_size / sharded->p);
+}
+
+float get_sharded_internal_fragmentation(struct sharded_memory* sharded) {
+    uint64_t used_size = 0;
+    uint64_t requested_size = 0;
+    for (int i = 0; i < sharded->num_shards; i++) {
+        used_size += atomic_load_explicit(&sharded->shards[i].used_size, memory_order_relaxed);
+        requested_size += atomic_load_explicit(&sharded->shards[i].requested_size, memory_order_relaxed);
+    }
+    if (used_size == 0) return 0;
+    return (float)(100.0 * (used_size - requested_size) / used_size);
+}
+
+float get_sharded_alignment_padding(struct sharded_memory* sharded) {
+    uint64_t used_size = 0;
+    uint64_t padding_size = 0;
+    for (int i = 0; i < sharded->num_shards; i++) {
+        used_size += atomic_load_explicit(&sharded->shards[i].used_size, memory_order_relaxed);
+        padding_size += atomic_load_explicit(&sharded->shards[i].padding_size, memory_order_relaxed);
+    }
+    if (used_size == 0) return 0;
+    return (float)(100.0 * padding_size / used_size);
+}
+
+void free_sharded_memory(struct sharded_memory* sharded) {
+    for (int i = 0; i < sharded->num_shards; i++) {
+        free_memory(sharded->shards[i].mem);
+        pthread_mutex_destroy(&sharded->shards[i].mutex);
+    }
+    free(sharded->shards);
+    pthread_mutex_destroy(&sharded->available_mutex);
+    pthread_cond_destroy(&sharded->available);
+    free(sharded);
+}
@@ -0,0 +1,88 @@
+#ifndef CS303_SHARD_H
+#define CS303_SHARD_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "ds.h"
+#include "simulator.h"
+
+enum shard_policy {
+    SHARD_ROUND_ROBIN = 0,    // Shards take turns
+    SHARD_LEAST_LOADED = 1,   // Shard with the most free memory
+    SHARD_SIZE_AFFINITY = 2   // Processes of similar size share a shard
+};
+
+/*
+Independent region of a sharded memory, `mutex` guards `mem`
+*/
+struct memory_shard {
+    struct memory* mem;
+    uint64_t base_address;  // Address of the shard in the whole memory
+    pthread_mutex_t mutex;
+    _Atomic uint64_t used_size;  // Copies of the counters of `mem`, readable without `mutex`
+    _Atomic uint64_t requested_size;
+    _Atomic uint64_t padding_size;
+};
+
+/*
+Memory split into shards that are allocated and freed under their own locks
+A process goes to the shard picked by `policy` and spills over to the next shards if it does not fit
+*/
+struct sharded_memory {
+    uint64_t p;
+    uint64_t q;
+    int num_shards;
+    struct memory_shard* shards;
+    enum shard_policy policy;
+    enum placement_algo algo;
+    uint64_t max_process_size;  // Size affinity maps sizes up to this linearly onto the shards
+    _Atomic unsigned int next_shard;
+    _Atomic long frees;             // Incremented under `available_mutex` after every batch of frees
+    pthread_mutex_t available_mutex;
+    pthread_cond_t available;       // Signalled whenever `frees` changes
+};
+
+/*
+Splits the p - q bytes into `num_shards` shards of whole aligned blocks as evenly as possible
+*/
+struct sharded_memory* get_new_sharded_memory(uint64_t p, uint64_t q, int num_shards, enum placement_algo algo, struct block_layout* layout, enum shard_policy policy, uint64_t max_process_size);
+
+/*
+First shard to try for a process of `size` bytes
+*/
+int select_shard(struct sharded_memory* sharded, uint64_t size);
+
+/*
+Allocates from the selected shard, then from the following ones
+Returns NULL if no shard has room
+*/
+struct partition* allocate_from_shards(struct sharded_memory* sharded, struct process* proc);
+
+struct memory_shard* get_shard_of_partition(struct sharded_memory* sharded, struct partition* part);
+
+/*
+Frees `part` under the lock of its shard, call notify_shard_frees() once the batch is done
+*/
+void deallocate_from_shards(struct sharded_memory* sharded, struct partition* part);
+
+/*
+Wakes the allocators waiting in wait_for_shard_frees()
+*/
+void notify_shard_frees(struct sharded_memory* sharded);
+
+/*
+Blocks until something is freed after `frees` was read from `sharded->frees`
+*/
+void wait_for_shard_frees(struct sharded_memory* sharded, long frees);
+
+float get_sharded_memory_utilization(struct sharded_memory* sharded);
+
+float get_sharded_internal_fragmentation(struct sharded_memory* sharded);
+
+float get_sharded_alignment_padding(struct sharded_memory* sharded);
+
+void free_sharded_memory(struct sharded_memory* sharded);
+
+#endif
@@ -0,0 +1,92 @@
+#include "sharded_simulator.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "completion_service.h"
+#include "ds.h"
+#include "logger.h"
+#include "scheduling.h"
+#include "shard.h"
+#include "simulator.h"
+#include "trace.h"
+
+struct sharded_allocator_args {
+    struct process_scheduler* scheduler;
+    pthread_mutex_t* consumer_mutex;  // Serializes the allocators on `scheduler`, the consumer side of the queue
+    pthread_cond_t* process_queued;   // Waited on with `consumer_mutex` while the queue is empty
+    atomic_int* waiting_allocators;
+    struct sharded_memory* sharded;
+    pthread_mutex_t* stats_mutex;
+    struct stats* stat;
+    struct completion_service* completions;
+};
+
+/*
+Takes the next process off the queue and waits until some shard has room for it
+*/
+void* sharded_process_allocator(void* args) {
+    struct sharded_allocator_args* _args = (struct sharded_allocator_args*)(args);
+    struct process_scheduler* scheduler = _args->scheduler;
+    struct sharded_memory* sharded = _args->sharded;
+    struct stats* stat = _args->stat;
+
+    while (true) {
+        pthread_mutex_lock(_args->consumer_mutex);
+        wait_for_scheduled_process(scheduler, _args->consumer_mutex, _args->process_queued, _args->waiting_allocators);
+        struct process* proc = dequeue_scheduled_process(scheduler);
+        pthread_mutex_unlock(_args->consumer_mutex);
+        log_info("Spawing process (s: %.2fMB, d: %ds)", get_size_in_mb(proc->s), proc->d);
+
+        struct partition* part;
+        while (true) {
+            long frees = atomic_load(&sharded->frees);
+            part = allocate_from_shards(sharded, proc);
+            if (part != NULL) break;
+            log_warning("Not enough memory for process (s: %.2fMB, d: %ds)", get_size_in_mb(proc->s), proc->d);
+            wait_for_shard_frees(sharded, frees);
+        }
+        struct memory_shard* shard = get_shard_of_partition(sharded, part);
+        uint64_t address = shard->base_address + part->address;
+        log_info("Process (s: %.2fMB, d: %ds) allocated %.2fMB partition [%lu, %lu] in shard %d", get_size_in_mb(proc->s), proc->d, get_size_in_mb(part->size), address, address + part->size, (int)(shard - sharded->shards));
+
+        pthread_mutex_lock(_args->stats_mutex);
+        record_process_start(stat, proc, get_time_diff_in_millis(proc->arrival_time, get_curr_time()));
+        stat->memory_utilization_num += get_sharded_memory_utilization(sharded);
+        stat->memory_utilization_den += 1;
+        stat->internal_fragmentation_num += get_sharded_internal_fragmentation(sharded);
+        stat->internal_fragmentation_den += 1;
+        stat->alignment_padding_num += get_sharded_alignment_padding(sharded);
+        stat->alignment_padding_den += 1;
+        log_stats(stat);
+        pthread_mutex_unlock(_args->stats_mutex);
+
+        schedule_completion(_args->completions, proc, part);  // Last, the completion service may free both right away
+    }
+}
+
+void run_sharded(int p, int q, int m, int t, float r, struct arrival_model* arrivals, enum placement_algo algo, struct block_layout* layout, int MAX_QUEUE_SIZE, int num_shards, int num_allocators, enum shard_policy policy, enum scheduling_policy scheduling, struct trace_reader* replay, struct trace_writer* record, struct stats* stat) {
+    struct process_queue* queue = get_new_empty_queue(MAX_QUEUE_SIZE);
+    struct sharded_memory* sharded = get_new_sharded_memory(p * BYTES_PER_MB, q * BYTES_PER_MB, num_shards, algo, layout, policy, 3 * m * BYTES_PER_MB);
+    struct completion_service* completions = start_sharded_completion_service(sharded);
+
+    struct sharded_allocator_args* args = (struct sharded_allocator_args*)malloc(sizeof(struct sharded_allocator_args));
+    args->scheduler = get_new_process_scheduler(queue, scheduling);
+    args->consumer_mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+    args->process_queued = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+    args->waiting_allocators = (atomic_int*)malloc(sizeof(atomic_int));
+    args->sharded = sharded;
+    args->stats_mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+    args->stat = stat;
+    args->completions = completions;
+    pthread_mutex_init(args->consumer_mutex, NULL);
+    pthread_cond_init(args->process_queued, NULL);
+    atomic_init(args->waiting_allocators, 0);
+    pthread_mutex_init(args->stats_mutex, NULL);
+
+    pthread_t process_creator_thread_id, process_allocator_thread_id;
+    pthread_create(&process_creator_thread_id, NULL, process_creator, get_process_creator_args(queue, r, arrivals, m, t, replay, record, args->consumer_mutex, args->process_queued, args->waiting_allocators, stat));
+    for (int i = 0; i < num_allocators; i++)
+        pthread_create(&process_allocator_thread_id, NULL, sharded_process_allocator, args);
+}
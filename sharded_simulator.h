@@ -0,0 +1,18 @@
+#ifndef CS303_SHARDED_SIMULATOR_H
+#define CS303_SHARDED_SIMULATOR_H
+
+#include "arrival.h"
+#include "ds.h"
+#include "scheduling.h"
+#include "shard.h"
+#include "simulator.h"
+#include "trace.h"
+
+/*
+Same as run() over `num_shards` independently locked regions of memory, with `num_allocators` allocator threads
+A process that fits in no shard keeps its allocator waiting until something is freed, the other allocators go on with the queue
+Allocators take processes off the queue in the order of `scheduling`
+*/
+void run_sharded(int p, int q, int m, int t, float r, struct arrival_model* arrivals, enum placement_algo algo, struct block_layout* layout, int MAX_QUEUE_SIZE, int num_shards, int num_allocators, enum shard_policy policy, enum scheduling_policy scheduling, struct trace_reader* replay, struct trace_writer* record, struct stats* stat);
+
+#endif
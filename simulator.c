@@ -1,71 +1,88 @@
 #include "simulator.h"
 
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <sys/time.h>
 #include <unistd.h>
 
+#include "arrival.h"
+#include "backfill.h"
+#include "bitmap.h"
+#include "buddy.h"
+#include "compaction.h"
+#include "completion_service.h"
 #include "ds.h"
 #include "helper.h"
+#include "histogram.h"
 #include "logger.h"
-
-struct run_process_args {
-    struct process* proc;
-    struct partition* part;
-    int partition_address;
-    pthread_mutex_t* mem_mutex;
-    pthread_cond_t* mem_available;
-};
+#include "scheduling.h"
+#include "table.h"
+#include "trace.h"
 
 struct process_creator_args {
     struct process_queue* queue;
-    int r;
+    float r;
+    struct arrival_model* arrivals;  // NULL for Poisson arrivals
     int m;
     int t;
-    pthread_mutex_t* queue_mutex;
+    struct trace_reader* replay;
+    struct trace_writer* record;
+    pthread_mutex_t* queue_mutex;     // Held by the allocators while they wait for `process_queued`
+    pthread_cond_t* process_queued;  // Signalled after a queued process if `waiting_allocators` is not 0
+    atomic_int* waiting_allocators;
+    struct stats* stat;              // Counts the dropped arrivals
 };
 
 struct process_allocator_args {
     struct process_queue* queue;
-    int p;
-    int q;
+    struct process_scheduler* scheduler;  // Consumer side of `queue`
+    uint64_t p;
+    uint64_t q;
+    struct block_layout* layout;
     pthread_mutex_t* mem_mutex;
-    pthread_mutex_t* queue_mutex;
     pthread_cond_t* mem_available;
+    pthread_cond_t* process_queued;  // Waited on with `mem_mutex` while the queue is empty, `mem_available` itself with backfilling
+    atomic_int* waiting_allocators;
     enum placement_algo algo;
     struct stats* stat;
+    struct completion_service* completions;
+    struct compaction_policy* compaction;
+    struct backfill_scheduler* backfill;
 };
 
-struct run_process_args* get_run_process_args(struct process* proc, struct partition* part, int partition_address, pthread_mutex_t* mem_mutex, pthread_cond_t* mem_available) {
-    struct run_process_args* args = (struct run_process_args*)malloc(sizeof(struct run_process_args));
-    args->proc = proc;
-    args->part = part;
-    args->partition_address = partition_address;
-    args->mem_mutex = mem_mutex;
-    args->mem_available = mem_available;
-    return args;
-}
-
-struct process_creator_args* get_process_creator_args(struct process_queue* queue, int r, int m, int t, pthread_mutex_t* queue_mutex) {
+struct process_creator_args* get_process_creator_args(struct process_queue* queue, float r, struct arrival_model* arrivals, int m, int t, struct trace_reader* replay, struct trace_writer* record, pthread_mutex_t* queue_mutex, pthread_cond_t* process_queued, atomic_int* waiting_allocators, struct stats* stat) {
     struct process_creator_args* args = (struct process_creator_args*)malloc(sizeof(struct process_creator_args));
     args->queue = queue;
     args->m = m;
     args->t = t;
     args->r = r;
+    args->arrivals = arrivals;
+    args->replay = replay;
+    args->record = record;
     args->queue_mutex = queue_mutex;
+    args->process_queued = process_queued;
+    args->waiting_allocators = waiting_allocators;
+    args->stat = stat;
     return args;
 }
 
-struct process_allocator_args* get_process_allocator_args(struct process_queue* queue, int p, int q, pthread_mutex_t* mem_mutex, pthread_mutex_t* queue_mutex, pthread_cond_t* mem_available, enum placement_algo algo, struct stats* stat) {
+struct process_allocator_args* get_process_allocator_args(struct process_queue* queue, struct process_scheduler* scheduler, uint64_t p, uint64_t q, struct block_layout* layout, pthread_mutex_t* mem_mutex, pthread_cond_t* mem_available, pthread_cond_t* process_queued, atomic_int* waiting_allocators, enum placement_algo algo, struct stats* stat, struct completion_service* completions, struct backfill_scheduler* backfill, struct compaction_policy* compaction) {
     struct process_allocator_args* args = (struct process_allocator_args*)malloc(sizeof(struct process_allocator_args));
     args->queue = queue;
+    args->scheduler = scheduler;
     args->p = p;
     args->q = q;
+    args->layout = layout;
     args->mem_mutex = mem_mutex;
-    args->queue_mutex = queue_mutex;
     args->mem_available = mem_available;
+    args->process_queued = process_queued;
+    args->waiting_allocators = waiting_allocators;
     args->algo = algo;
     args->stat = stat;
+    args->completions = completions;
+    args->compaction = compaction;
+    args->backfill = backfill;
     return args;
 }
 
@@ -79,13 +96,40 @@ long get_time_diff_in_millis(struct timeval start, struct timeval end) {
     return ((end.tv_sec - start.tv_sec) * 1000000 + end.tv_usec - start.tv_usec) / 1000;
 }
 
-struct process* get_random_process(int m, int t) {
-    int size_in_megabyte = 10 * ((5 + randint(0.5 * m, 3.0 * m)) / 10);
-    int duration_in_sec = 5 * ((int)((2.5 + randint(0.5 * t, 6.0 * t)) / 5));
-    return get_new_process(size_in_megabyte, duration_in_sec, get_curr_time());
+struct timeval get_time_after(struct timeval start, double millis) {
+    long micros = start.tv_usec + (long)(millis * 1000);
+    struct timeval t;
+    t.tv_sec = start.tv_sec + micros / 1000000;
+    t.tv_usec = micros % 1000000;
+    return t;
 }
 
-struct partition* allocate(struct memory* mem, struct process* proc, int* last_address, enum placement_algo algo) {
+float get_random_arrival_rate(int n, struct rng* rng) {
+    return randint_r(rng, 0.1 * n * 1e4, 1.2 * n * 1e4) / 1e4;
+}
+
+struct process* get_random_process(struct process_queue* queue, int m, int t, struct timeval arrival_time, struct rng* rng) {
+    uint64_t min_size = m * BYTES_PER_MB / 2;
+    uint64_t size = min_size + get_rng_below(rng != NULL ? rng : get_thread_rng(), 6 * min_size - min_size + 1);
+    int duration_in_sec = 5 * ((int)((2.5 + randint_r(rng, 0.5 * t, 6.0 * t)) / 5));
+    return get_new_queued_process(queue, size, duration_in_sec, arrival_time);
+}
+
+struct memory* get_new_memory_for_algo(uint64_t p, uint64_t q, enum placement_algo algo, struct block_layout* layout) {
+    struct block_layout default_layout;
+    init_block_layout(&default_layout, DEFAULT_ALIGNMENT, DEFAULT_MIN_BLOCK_SIZE);
+    if (layout == NULL)
+        layout = &default_layout;
+    if (algo == BUDDY)
+        return get_new_buddy_memory_with_layout(p, q, layout);
+    if (algo == BITMAP_FIRST_FIT || algo == BITMAP_BEST_FIT || algo == BITMAP_NEXT_FIT)
+        return get_new_bitmap_memory_with_layout(p, q, layout);
+    if (algo == TABLE_FIRST_FIT || algo == TABLE_BEST_FIT || algo == TABLE_NEXT_FIT || algo == TABLE_WORST_FIT)
+        return get_new_table_memory_with_layout(p, q, layout);
+    return get_new_memory_with_layout(p, q, layout);
+}
+
+struct partition* allocate(struct memory* mem, struct process* proc, enum placement_algo algo) {
     switch (algo) {
         case FIRST_FIT:
             return first_fit(mem, proc->s);
@@ -94,113 +138,284 @@ struct partition* allocate(struct memory* mem, struct process* proc, int* last_a
             return best_fit(mem, proc->s);
             break;
         case NEXT_FIT:
-            return next_fit(mem, proc->s, *last_address);
+            return roving_next_fit(mem, proc->s);
+            break;
+        case BUDDY:
+            return buddy_fit(mem, proc->s);
+            break;
+        case WORST_FIT:
+            return worst_fit(mem, proc->s);
+            break;
+        case TLSF:
+            return tlsf_fit(mem, proc->s);
+            break;
+        case BITMAP_FIRST_FIT:
+            return bitmap_first_fit(mem, proc->s);
+            break;
+        case BITMAP_BEST_FIT:
+            return bitmap_best_fit(mem, proc->s);
+            break;
+        case BITMAP_NEXT_FIT:
+            return bitmap_next_fit(mem, proc->s);
+            break;
+        case TABLE_FIRST_FIT:
+            return table_first_fit(mem, proc->s);
+            break;
+        case TABLE_BEST_FIT:
+            return table_best_fit(mem, proc->s);
+            break;
+        case TABLE_NEXT_FIT:
+            return table_next_fit(mem, proc->s);
+            break;
+        case TABLE_WORST_FIT:
+            return table_worst_fit(mem, proc->s);
             break;
     }
+    return NULL;
 }
 
-void* run_process(void* args) {
-    struct run_process_args* _args = (struct run_process_args*)(args);
-    struct process* proc = _args->proc;
-    sleep(proc->d);
-    pthread_mutex_t* mem_mutex = _args->mem_mutex;
-    pthread_mutex_lock(mem_mutex);
-    struct partition* part = _args->part;
-    int address = _args->partition_address;
-    deallocate_partition(part);
-    log_warning("%dMB partition [%d, %d] freed from process (s: %dMB, d: %ds)", proc->s, address, address + proc->s, proc->s, proc->d);
-    free_process(proc);
-    pthread_mutex_unlock(mem_mutex);
-    pthread_cond_broadcast(_args->mem_available);
+void record_process_start(struct stats* stat, struct process* proc, long wait_time_in_millis) {
+    stat->turnaround_time_num += wait_time_in_millis;
+    stat->turnaround_time_den += 1;
+    record_histogram_value(&stat->queue_wait_time, wait_time_in_millis);
+    record_histogram_value(&stat->turnaround_time, wait_time_in_millis + proc->d * 1000L);
+}
+
+void record_memory_stats(struct stats* stat, struct memory* mem) {
+    stat->memory_utilization_num += get_percentage_memory_utilization(mem);
+    stat->memory_utilization_den += 1;
+    stat->internal_fragmentation_num += get_percentage_internal_fragmentation(mem);
+    stat->internal_fragmentation_den += 1;
+    stat->alignment_padding_num += get_percentage_alignment_padding(mem);
+    stat->alignment_padding_den += 1;
+}
+
+float get_avg_turnaround_time(struct stats* stat) {
+    return (stat->turnaround_time_den == 0 ? 0 : (1.0f * stat->turnaround_time_num) / stat->turnaround_time_den);
+}
+
+float get_avg_memory_utilization(struct stats* stat) {
+    return (stat->memory_utilization_den == 0 ? 0 : (stat->memory_utilization_num / stat->memory_utilization_den));
+}
+
+float get_avg_internal_fragmentation(struct stats* stat) {
+    return (stat->internal_fragmentation_den == 0 ? 0 : stat->internal_fragmentation_num / stat->internal_fragmentation_den);
+}
+
+float get_avg_alignment_padding(struct stats* stat) {
+    return (stat->alignment_padding_den == 0 ? 0 : stat->alignment_padding_num / stat->alignment_padding_den);
+}
+
+void merge_stats(struct stats* dst, struct stats* src) {
+    dst->turnaround_time_num += src->turnaround_time_num;
+    dst->turnaround_time_den += src->turnaround_time_den;
+    dst->memory_utilization_num += src->memory_utilization_num;
+    dst->memory_utilization_den += src->memory_utilization_den;
+    dst->internal_fragmentation_num += src->internal_fragmentation_num;
+    dst->internal_fragmentation_den += src->internal_fragmentation_den;
+    dst->alignment_padding_num += src->alignment_padding_num;
+    dst->alignment_padding_den += src->alignment_padding_den;
+    dst->compactions += src->compactions;
+    dst->compaction_moved_size += src->compaction_moved_size;
+    dst->compaction_time_in_millis += src->compaction_time_in_millis;
+    merge_histogram(&dst->queue_wait_time, &src->queue_wait_time);
+    merge_histogram(&dst->turnaround_time, &src->turnaround_time);
+    atomic_fetch_add(&dst->dropped_arrivals, atomic_load(&src->dropped_arrivals));
+}
+
+void log_histogram_stat(const char* name, struct histogram* histogram) {
+    if (get_histogram_count(histogram) == 0) return;
+    log_stat("%s p50: %ldms, p90: %ldms, p99: %ldms, p99.9: %ldms, max: %ldms", name, get_histogram_percentile(histogram, 50), get_histogram_percentile(histogram, 90), get_histogram_percentile(histogram, 99), get_histogram_percentile(histogram, 99.9), get_histogram_max(histogram));
+}
+
+void log_stats(struct stats* stat) {
+    float avg_turnaround_time = get_avg_turnaround_time(stat);
+    float avg_mem_util = get_avg_memory_utilization(stat);
+    float avg_internal_fragmentation = get_avg_internal_fragmentation(stat);
+    float avg_alignment_padding = get_avg_alignment_padding(stat);
+    log_stat("Avg. queue wait time: %.2fms, Avg. memory util: %.2f%%, Avg. internal fragmentation: %.2f%% (alignment padding: %.2f%%)", avg_turnaround_time, avg_mem_util, avg_internal_fragmentation, avg_alignment_padding);
+    log_histogram_stat("Queue wait", &stat->queue_wait_time);
+    log_histogram_stat("Turnaround", &stat->turnaround_time);
+    if (stat->compactions > 0)
+        log_stat("Compactions: %d, Relocated: %.2fMB, Relocation time: %ldms", stat->compactions, get_size_in_mb(stat->compaction_moved_size), stat->compaction_time_in_millis);
+    long dropped_arrivals = atomic_load(&stat->dropped_arrivals);
+    if (dropped_arrivals > 0)
+        log_stat("Arrivals dropped on a full queue: %ld", dropped_arrivals);
+}
+
+void count_dropped_arrival(struct process_creator_args* args) {
+    atomic_fetch_add(&args->stat->dropped_arrivals, 1);
+}
+
+/*
+Waits on `process_queued` with `queue_mutex` held, unless a process was queued since `queue` held `queue_size` of them
+Called by the only consumer of `queue`, so the queue only grows while it waits
+*/
+void wait_for_arrival(struct process_queue* queue, int queue_size, pthread_mutex_t* queue_mutex, pthread_cond_t* process_queued, atomic_int* waiting_allocators) {
+    atomic_fetch_add(waiting_allocators, 1);
+    atomic_thread_fence(memory_order_seq_cst);  // Pairs with the fence in queue_new_process()
+    if (get_queue_size(queue) == queue_size)
+        pthread_cond_wait(process_queued, queue_mutex);
+    atomic_fetch_sub(waiting_allocators, 1);
+}
+
+void wait_for_scheduled_process(struct process_scheduler* scheduler, pthread_mutex_t* queue_mutex, pthread_cond_t* process_queued, atomic_int* waiting_allocators) {
+    while (!has_scheduled_process(scheduler))
+        wait_for_arrival(scheduler->queue, 0, queue_mutex, process_queued, waiting_allocators);
+}
+
+/*
+Queues `proc` and wakes an allocator waiting for it, drops and frees it if the queue is full
+*/
+void queue_new_process(struct process_creator_args* args, struct process* proc) {
+    log_info("New process (s: %.2fMB, d: %ds) generated", get_size_in_mb(proc->s), proc->d);
+    if (enqueue(args->queue, proc)) {
+        log_info("Process (s: %.2fMB, d: %ds) queued", get_size_in_mb(proc->s), proc->d);
+        // Either an allocator sees the process on its recheck or this sees it waiting, see wait_for_scheduled_process()
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load(args->waiting_allocators) > 0) {
+            pthread_mutex_lock(args->queue_mutex);  // The allocator rechecks and waits under this lock, so the signal is not lost
+            pthread_cond_signal(args->process_queued);
+            pthread_mutex_unlock(args->queue_mutex);
+        }
+    } else {
+        log_warning("Process (s: %.2fMB, d: %ds) could NOT be queued, queue full", get_size_in_mb(proc->s), proc->d);
+        count_dropped_arrival(args);
+        free_process(proc);
+    }
+}
+
+/*
+Queues the processes of `replay` at their recorded arrival offsets, returns when the trace is over
+*/
+void replay_arrivals(struct process_creator_args* args) {
+    struct timeval start_time = get_curr_time();
+    const struct trace_record* arrival;
+    while ((arrival = next_trace_record(args->replay)) != NULL) {
+        long wait_in_millis = arrival->arrival_offset_in_millis - get_time_diff_in_millis(start_time, get_curr_time());
+        if (wait_in_millis > 0)
+            usleep(wait_in_millis * 1000);
+        struct process* proc = get_new_queued_process(args->queue, arrival->size, arrival->duration, get_time_after(start_time, arrival->arrival_offset_in_millis));
+        if (args->record != NULL)
+            write_trace_record(args->record, arrival->arrival_offset_in_millis, proc->s, proc->d);
+        queue_new_process(args, proc);
+    }
+    log_info("Trace replayed");
 }
 
 void* process_creator(void* args) {
     struct process_creator_args* _args = (struct process_creator_args*)(args);
     struct process_queue* queue = _args->queue;
-    pthread_mutex_t* queue_mutex = _args->queue_mutex;
-    int r = _args->r;
     int m = _args->m;
     int t = _args->t;
-    int step_time_in_millis = 10;
-    while (true) {
-        usleep(step_time_in_millis * 1000);
-        if (randint(0, 1000) < (r * step_time_in_millis)) {
-            if (!is_queue_full(queue)) {
-                struct process* proc = get_random_process(m, t);
-                pthread_mutex_lock(queue_mutex);
-                log_info("New process (s: %dMB, d: %ds) generated", proc->s, proc->d);
-                if (enqueue(queue, proc)) {
-                    log_info("Process (s: %dMB, d: %ds) queued", proc->s, proc->d);
-                } else {
-                    log_warning("Process (s: %dMB, d: %ds) could NOT be queued, queue full", proc->s, proc->d);
-                }
-                pthread_mutex_unlock(queue_mutex);
-            }
+    struct trace_writer* record = _args->record;
+    if (_args->replay != NULL) {
+        replay_arrivals(_args);
+        return NULL;
+    }
+    struct arrival_generator arrivals;
+    init_arrival_generator(&arrivals, _args->arrivals, _args->r);
+    struct timeval start_time = get_curr_time();
+    double arrival_in_millis;
+    int batch_size;
+    while ((batch_size = next_arrival_batch(&arrivals, get_thread_rng(), &arrival_in_millis)) > 0) {
+        struct timeval now = get_curr_time();
+        long wait_in_micros = (long)(arrival_in_millis * 1000) - ((now.tv_sec - start_time.tv_sec) * 1000000L + now.tv_usec - start_time.tv_usec);
+        if (wait_in_micros > 0)
+            usleep(wait_in_micros);  // Arrivals we are late for come out right away
+        for (int i = 0; i < batch_size; i++) {
+            // Stamped with when it was due, a late arrival has been waiting since then
+            // Drawn even if it is dropped, so a drop does not shift the draws of the arrivals after it
+            struct process* proc = get_random_process(queue, m, t, get_time_after(start_time, arrival_in_millis), NULL);
+            if (record != NULL)
+                write_trace_record(record, (long)arrival_in_millis, proc->s, proc->d);  // Dropped arrivals are recorded too, the trace holds every arrival
+            queue_new_process(_args, proc);
         }
     }
+    return NULL;
 }
 
 void* process_allocator(void* args) {
     struct process_allocator_args* _args = (struct process_allocator_args*)(args);
-    int p = _args->p;
-    int q = _args->q;
+    uint64_t p = _args->p;
+    uint64_t q = _args->q;
     struct process_queue* queue = _args->queue;
-    struct memory* mem = get_new_empty_memory(p, q);
+    struct process_scheduler* scheduler = _args->scheduler;
+    struct memory* mem = get_new_memory_for_algo(p, q, _args->algo, _args->layout);
     pthread_mutex_t* mem_mutex = _args->mem_mutex;
-    pthread_mutex_t* queue_mutex = _args->queue_mutex;
     pthread_cond_t* mem_available = _args->mem_available;
+    pthread_cond_t* process_queued = _args->process_queued;
+    atomic_int* waiting_allocators = _args->waiting_allocators;
     struct stats* stat = _args->stat;
     enum placement_algo algo = _args->algo;
-    int last_address = 0;
+    struct completion_service* completions = _args->completions;
+    struct compaction_policy* compaction = _args->compaction;
+    struct backfill_scheduler* backfill = _args->backfill;
+    struct timeval start_time = get_curr_time();
 
+    // Every queued process that fits is placed right away, the lock is released between two of them for the completions
     while (true) {
-        usleep(10000);
-        if (!is_queue_empty(queue)) {
-            struct process* proc = peek_queue(queue);
-            log_info("Spawing process (s: %dMB, d: %ds)", proc->s, proc->d);
-
-            pthread_mutex_lock(mem_mutex);  // Lock
-
-            struct partition* part = allocate(mem, proc, &last_address, algo);
-            if (part != NULL) {
-                stat->turnaround_time_num += get_time_diff_in_millis(proc->arrival_time, get_curr_time());
-                stat->turnaround_time_den += 1;
-                pthread_mutex_lock(queue_mutex);  // Q Lock
-                dequeue(queue);
-                pthread_mutex_unlock(queue_mutex);  // Q Unlock
-                int address = get_address_of_partition(mem, part);
-                pthread_t thread_id;
-                pthread_create(&thread_id, NULL, run_process, get_run_process_args(proc, part, address, mem_mutex, mem_available));
-                log_info("Process (s: %dMB, d: %ds) allocated %dMB partition [%d, %d]", proc->s, proc->d, part->size, address, address + part->size);
-
-                print_memory(mem);
-
-                float avg_turnaround_time = (stat->turnaround_time_den == 0 ? 0 : (1.0f * stat->turnaround_time_num) / stat->turnaround_time_den);
-                float avg_mem_util = (stat->memory_utilization_den == 0 ? 0 : (stat->memory_utilization_num / stat->memory_utilization_den));
-                log_stat("Avg. turnaround time: %.2fms, Avg. memory util: %.2f%", avg_turnaround_time, avg_mem_util);
-            } else {
-                log_warning("Not enough memory for process (s: %dMB, d: %ds)", proc->s, proc->d);
-                pthread_cond_wait(mem_available, mem_mutex);  // Condition wait
-            }
-            stat->memory_utilization_num += get_percentage_memory_utilization(mem);
-            stat->memory_utilization_den += 1;
+        pthread_mutex_lock(mem_mutex);  // Lock
+        wait_for_scheduled_process(scheduler, mem_mutex, process_queued, waiting_allocators);
 
-            pthread_mutex_unlock(mem_mutex);  // Unlock
+        int queue_size = get_queue_size(queue);
+        int offset = backfill != NULL ? find_backfill_process(backfill, queue, mem) : 0;
+        if (offset < 0) offset = 0;  // Nothing fits, the head may still fit after compaction
+        struct process* proc = backfill != NULL ? peek_queue_at(queue, offset) : peek_scheduled_process(scheduler);
+        log_info("Spawing process (s: %.2fMB, d: %ds)", get_size_in_mb(proc->s), proc->d);
+
+        struct partition* part = allocate(mem, proc, algo);
+        if (part == NULL && should_compact_after_failure(compaction, mem, proc->s)) {
+            compact_and_record(compaction, mem, stat, get_time_diff_in_millis(start_time, get_curr_time()));
+            part = allocate(mem, proc, algo);
+        }
+        if (part != NULL) {
+            record_process_start(stat, proc, get_time_diff_in_millis(proc->arrival_time, get_curr_time()));
+            if (backfill != NULL)
+                take_backfill_process(backfill, queue, offset);
+            else
+                dequeue_scheduled_process(scheduler);
+            uint64_t address = get_address_of_partition(part);
+            schedule_completion(completions, proc, part);
+            log_info("Process (s: %.2fMB, d: %ds) allocated %.2fMB partition [%lu, %lu]", get_size_in_mb(proc->s), proc->d, get_size_in_mb(part->size), address, address + part->size);
+
+            print_memory(mem);
+
+            log_stats(stat);
+        } else {
+            log_warning("Not enough memory for process (s: %.2fMB, d: %ds)", get_size_in_mb(proc->s), proc->d);
+            if (backfill != NULL)
+                wait_for_arrival(queue, queue_size, mem_mutex, mem_available, waiting_allocators);  // A process queued since the scan may fit
+            else
+                pthread_cond_wait(mem_available, mem_mutex);  // Condition wait
         }
+        long now_in_millis = get_time_diff_in_millis(start_time, get_curr_time());
+        if (should_compact(compaction, mem, now_in_millis))
+            compact_and_record(compaction, mem, stat, now_in_millis);
+        record_memory_stats(stat, mem);
+
+        pthread_mutex_unlock(mem_mutex);  // Unlock
     }
 }
 
-void run(int p, int q, int n, int m, int t, int r, enum placement_algo algo, int MAX_QUEUE_SIZE, struct stats* stat) {
+void run(int p, int q, int m, int t, float r, struct arrival_model* arrivals, enum placement_algo algo, struct block_layout* layout, int MAX_QUEUE_SIZE, struct trace_reader* replay, struct trace_writer* record, enum scheduling_policy scheduling, struct backfill_scheduler* backfill, struct compaction_policy* compaction, struct stats* stat) {
     struct process_queue* queue = get_new_empty_queue(MAX_QUEUE_SIZE);
     pthread_mutex_t* mem_mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
-    pthread_mutex_t* queue_mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
     pthread_cond_t* mem_available = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+    pthread_cond_t* process_queued = mem_available;  // With backfilling arrivals wake the wait for memory too, see process_allocator()
+    atomic_int* waiting_allocators = (atomic_int*)malloc(sizeof(atomic_int));
 
     pthread_mutex_init(mem_mutex, NULL);
-    pthread_mutex_init(queue_mutex, NULL);
     pthread_cond_init(mem_available, NULL);
+    if (backfill == NULL) {
+        process_queued = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+        pthread_cond_init(process_queued, NULL);
+    }
+    atomic_init(waiting_allocators, 0);
+
+    struct completion_service* completions = start_completion_service(mem_mutex, mem_available);
 
     pthread_t process_creator_thread_id, process_allocator_thread_id;
-    pthread_create(&process_creator_thread_id, NULL, process_creator, get_process_creator_args(queue, r, m, t, queue_mutex));
-    pthread_create(&process_allocator_thread_id, NULL, process_allocator, get_process_allocator_args(queue, p, q, mem_mutex, queue_mutex, mem_available, algo, stat));
+    pthread_create(&process_creator_thread_id, NULL, process_creator, get_process_creator_args(queue, r, arrivals, m, t, replay, record, mem_mutex, process_queued, waiting_allocators, stat));
+    pthread_create(&process_allocator_thread_id, NULL, process_allocator, get_process_allocator_args(queue, get_new_process_scheduler(queue, scheduling), p * BYTES_PER_MB, q * BYTES_PER_MB, layout, mem_mutex, mem_available, process_queued, waiting_allocators, algo, stat, completions, backfill, compaction));
 }
\ No newline at end of file
@@ -1,14 +1,113 @@
 #ifndef CS303_SIMULATOR_H
 #define CS303_SIMULATOR_H
 
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "arrival.h"
+#include "backfill.h"
+#include "compaction.h"
 #include "ds.h"
+#include "rng.h"
+#include "scheduling.h"
+#include "trace.h"
+
+#define DEFAULT_ALIGNMENT (4096)  // Bytes, one page
+#define DEFAULT_MIN_BLOCK_SIZE (4096)
 
 enum placement_algo {
     FIRST_FIT = 0,
     BEST_FIT = 1,
-    NEXT_FIT = 2
+    NEXT_FIT = 2,
+    BUDDY = 3,
+    WORST_FIT = 4,
+    TLSF = 5,
+    BITMAP_FIRST_FIT = 6,  // Same placements over a bitmap of fixed units, see bitmap.h
+    BITMAP_BEST_FIT = 7,
+    BITMAP_NEXT_FIT = 8,
+    TABLE_FIRST_FIT = 9,  // Same placements over a structure of arrays partition table, see table.h
+    TABLE_BEST_FIT = 10,
+    TABLE_NEXT_FIT = 11,
+    TABLE_WORST_FIT = 12
 };
 
-void run(int p, int q, int n, int m, int t, int r, enum placement_algo algo, int MAX_QUEUE_SIZE, struct stats* stat);
+struct timeval get_curr_time();
+
+long get_time_diff_in_millis(struct timeval start, struct timeval end);
+
+struct timeval get_time_after(struct timeval start, double millis);
+
+/*
+Number of processes spawning per second for the arrival rate parameter `n`
+`rng` is the generator to draw from, NULL draws from the generator of the calling thread
+*/
+float get_random_arrival_rate(int n, struct rng* rng);
+
+/*
+Process of [0.5 * `m`, 3 * `m`] MBs at byte granularity, running for about [0.5 * `t`, 6 * `t`] seconds
+*/
+struct process* get_random_process(struct process_queue* queue, int m, int t, struct timeval arrival_time, struct rng* rng);
+
+/*
+Memory of `p` bytes laid out for the placement algorithm, BUDDY needs a buddy memory
+NULL `layout` aligns partitions to DEFAULT_ALIGNMENT
+*/
+struct memory* get_new_memory_for_algo(uint64_t p, uint64_t q, enum placement_algo algo, struct block_layout* layout);
+
+struct partition* allocate(struct memory* mem, struct process* proc, enum placement_algo algo);
+
+/*
+Records a process allocated after waiting `wait_time_in_millis` in the queue, it completes `proc->d` seconds later
+*/
+void record_process_start(struct stats* stat, struct process* proc, long wait_time_in_millis);
+
+void record_memory_stats(struct stats* stat, struct memory* mem);
+
+float get_avg_turnaround_time(struct stats* stat);
+
+float get_avg_memory_utilization(struct stats* stat);
+
+float get_avg_internal_fragmentation(struct stats* stat);
+
+/*
+Share of the allocated memory only spent on aligning the requested sizes, part of the internal fragmentation
+*/
+float get_avg_alignment_padding(struct stats* stat);
+
+/*
+Adds everything recorded in `src` to `dst`, e.g. to summarize several runs
+*/
+void merge_stats(struct stats* dst, struct stats* src);
+
+void log_stats(struct stats* stat);
+
+/*
+Waits on `process_queued` with `queue_mutex` held until `scheduler` has a process
+`waiting_allocators` counts the waiting threads, so the creator only takes `queue_mutex` to signal when one is waiting
+*/
+void wait_for_scheduled_process(struct process_scheduler* scheduler, pthread_mutex_t* queue_mutex, pthread_cond_t* process_queued, atomic_int* waiting_allocators);
+
+/*
+A queued process signals `process_queued` under `queue_mutex` if an allocator is counted in `waiting_allocators`,
+arrivals dropped on a full queue are counted in `stat`
+*/
+struct process_creator_args* get_process_creator_args(struct process_queue* queue, float r, struct arrival_model* arrivals, int m, int t, struct trace_reader* replay, struct trace_writer* record, pthread_mutex_t* queue_mutex, pthread_cond_t* process_queued, atomic_int* waiting_allocators, struct stats* stat);
+
+/*
+Thread that queues new processes at their arrival times, takes struct process_creator_args
+Processes are stamped with the time they were due, not the time they were queued
+*/
+void* process_creator(void* args);
+
+/*
+`p`, `q` and `m` are in MBs, partitions are laid out by `layout`, NULL for the default alignment
+Processes arrive from `replay` if not NULL, otherwise they are generated at a mean rate of `r` per second
+shaped by `arrivals`, which may be NULL for Poisson arrivals
+Every arrival is appended to `record` if not NULL
+Queued processes are allocated in the order of `scheduling`
+Queued processes overtake a head that does not fit if `backfill` is not NULL, which requires FIFO scheduling
+`compaction` may be NULL, which never compacts
+*/
+void run(int p, int q, int m, int t, float r, struct arrival_model* arrivals, enum placement_algo algo, struct block_layout* layout, int MAX_QUEUE_SIZE, struct trace_reader* replay, struct trace_writer* record, enum scheduling_policy scheduling, struct backfill_scheduler* backfill, struct compaction_policy* compaction, struct stats* stat);
 
 #endif
\ No newline at end of file
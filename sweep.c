@@ -0,0 +1,188 @@
+#include "sweep.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compaction.h"
+#include "ds.h"
+#include "event_simulator.h"
+#include "histogram.h"
+#include "logger.h"
+#include "rng.h"
+#include "simulator.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+#define MAX_SWEEP_VALUES (4096)  // Per parameter
+
+struct sweep* get_new_sweep() {
+    struct sweep* sweep = (struct sweep*)malloc(sizeof(struct sweep));
+    sweep->replay_path = NULL;
+    init_arrival_model(&sweep->arrivals, ARRIVALS_POISSON, 1, DEFAULT_MMPP_PEAK_FACTOR, DEFAULT_MMPP_DWELL_IN_MILLIS);
+    init_block_layout(&sweep->layout, DEFAULT_ALIGNMENT, DEFAULT_MIN_BLOCK_SIZE);
+    sweep->size = 0;
+    sweep->capacity = 16;
+    sweep->runs = (struct sweep_run*)malloc(sweep->capacity * sizeof(struct sweep_run));
+    return sweep;
+}
+
+/*
+Parses a comma separated list of values and inclusive ranges into `values`
+Returns the number of values, -1 if `field` is malformed
+*/
+int parse_sweep_values(char* field, long* values) {
+    int count = 0;
+    char* save;
+    for (char* token = strtok_r(field, ",", &save); token != NULL; token = strtok_r(NULL, ",", &save)) {
+        long from, to;
+        char extra;
+        if (sscanf(token, "%ld-%ld%c", &from, &to, &extra) == 2) {
+            if (from > to) return -1;
+        } else if (sscanf(token, "%ld%c", &from, &extra) == 1) {
+            to = from;
+        } else {
+            return -1;
+        }
+        for (long value = from; value <= to; value++) {
+            if (count == MAX_SWEEP_VALUES) return -1;
+            values[count++] = value;
+        }
+    }
+    return count == 0 ? -1 : count;
+}
+
+bool is_valid_sweep_run(struct sweep_run* run) {
+    return run->p > 0 && run->q > 0 && run->q < run->p && run->n > 0 && run->m > 0 && run->t > 0 && run->T > 0 && run->MAX_QUEUE_SIZE > 0 && run->algo >= FIRST_FIT && run->algo <= TABLE_WORST_FIT && run->scheduling >= SCHEDULE_FIFO && run->scheduling <= SCHEDULE_PRIORITY_CLASSES;
+}
+
+void add_sweep_run(struct sweep* sweep, struct sweep_run* run) {
+    if (sweep->size == sweep->capacity) {
+        sweep->capacity *= 2;
+        sweep->runs = (struct sweep_run*)realloc(sweep->runs, sweep->capacity * sizeof(struct sweep_run));
+    }
+    sweep->runs[sweep->size++] = *run;
+}
+
+bool add_sweep_grid(struct sweep* sweep, const char* line, struct compaction_policy* compaction) {
+    char* copy = strdup(line);
+    long* values[NUM_SWEEP_PARAMETERS];
+    int counts[NUM_SWEEP_PARAMETERS];
+    int num_fields = 0;
+    bool valid = true;
+    char* save;
+    for (char* field = strtok_r(copy, " \t\r\n", &save); field != NULL; field = strtok_r(NULL, " \t\r\n", &save)) {
+        if (num_fields == NUM_SWEEP_PARAMETERS) {
+            valid = false;
+            break;
+        }
+        values[num_fields] = (long*)malloc(MAX_SWEEP_VALUES * sizeof(long));
+        counts[num_fields] = parse_sweep_values(field, values[num_fields]);
+        num_fields++;
+        if (counts[num_fields - 1] < 0) {
+            valid = false;
+            break;
+        }
+    }
+    valid = valid && num_fields >= NUM_SWEEP_PARAMETERS - 1;
+    if (valid && num_fields == NUM_SWEEP_PARAMETERS - 1) {
+        values[num_fields] = (long*)malloc(sizeof(long));  // FIFO scheduling
+        values[num_fields][0] = SCHEDULE_FIFO;
+        counts[num_fields] = 1;
+        num_fields++;
+    }
+
+    int first_run = sweep->size;
+    int index[NUM_SWEEP_PARAMETERS] = {0};
+    while (valid) {
+        struct sweep_run run;
+        run.p = values[0][index[0]];
+        run.q = values[1][index[1]];
+        run.n = values[2][index[2]];
+        run.m = values[3][index[3]];
+        run.t = values[4][index[4]];
+        run.T = values[5][index[5]];
+        run.MAX_QUEUE_SIZE = values[6][index[6]];
+        run.algo = values[7][index[7]];
+        run.seed = values[8][index[8]];
+        run.scheduling = values[9][index[9]];
+        run.r = 0;
+        run.compaction = *compaction;
+        run.stat = NULL;
+        if (!is_valid_sweep_run(&run)) {
+            valid = false;
+            break;
+        }
+        add_sweep_run(sweep, &run);
+
+        int i = NUM_SWEEP_PARAMETERS - 1;  // Odometer over the value lists, the scheduling policy changes fastest
+        while (i >= 0 && ++index[i] == counts[i]) {
+            index[i] = 0;
+            i--;
+        }
+        if (i < 0) break;
+    }
+    if (!valid)
+        sweep->size = first_run;
+
+    for (int i = 0; i < num_fields; i++)
+        free(values[i]);
+    free(copy);
+    return valid;
+}
+
+struct sweep_task {
+    struct sweep* sweep;
+    struct sweep_run* run;
+};
+
+void run_sweep_task(void* arg) {
+    struct sweep_task* task = (struct sweep_task*)arg;
+    struct sweep_run* run = task->run;
+    struct trace_reader* replay = task->sweep->replay_path != NULL ? open_trace_reader(task->sweep->replay_path) : NULL;
+    struct rng rng;
+    seed_rng(&rng, run->seed);
+    run->r = get_random_arrival_rate(run->n, &rng);
+    run->stat = get_empty_stats();
+    struct compaction_policy* compaction = run->compaction.trigger == COMPACTION_DISABLED ? NULL : &run->compaction;
+    run_event_driven(run->p, run->q, run->m, run->t, run->r, &task->sweep->arrivals, run->algo, &task->sweep->layout, run->MAX_QUEUE_SIZE, run->T, next_rng(&rng), replay, NULL, run->scheduling, NULL, compaction, run->stat);
+    if (replay != NULL)
+        close_trace_reader(replay);
+}
+
+void run_sweep(struct sweep* sweep, int num_threads) {
+    struct sweep_task* tasks = (struct sweep_task*)malloc(sweep->size * sizeof(struct sweep_task));
+    mute_logs();
+    struct thread_pool* pool = get_new_thread_pool(num_threads);
+    for (int i = 0; i < sweep->size; i++) {
+        tasks[i].sweep = sweep;
+        tasks[i].run = &sweep->runs[i];
+        submit_task(pool, run_sweep_task, &tasks[i]);
+    }
+    free_thread_pool(pool);
+    unmute_logs();
+    free(tasks);
+}
+
+void write_sweep_csv(struct sweep* sweep, FILE* stream) {
+    fprintf(stream, "p,q,n,m,t,T,max_queue_size,algo,seed,scheduling,r,allocated_processes,avg_queue_wait_ms,queue_wait_p50_ms,queue_wait_p99_ms,queue_wait_max_ms,turnaround_p50_ms,turnaround_p99_ms,turnaround_p999_ms,turnaround_max_ms,avg_memory_utilization,avg_internal_fragmentation,avg_alignment_padding,compactions,compaction_moved_size\n");
+    for (int i = 0; i < sweep->size; i++) {
+        struct sweep_run* run = &sweep->runs[i];
+        struct stats* stat = run->stat;
+        if (stat == NULL) continue;
+        struct histogram* wait = &stat->queue_wait_time;
+        struct histogram* turnaround = &stat->turnaround_time;
+        fprintf(stream, "%d,%d,%d,%d,%d,%d,%d,%d,%u,%d,%.4f,%d,%.2f,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%.2f,%.2f,%.2f,%d,%ld\n", run->p, run->q, run->n, run->m, run->t, run->T, run->MAX_QUEUE_SIZE, run->algo, run->seed, run->scheduling, run->r, stat->turnaround_time_den, get_avg_turnaround_time(stat),
+                get_histogram_percentile(wait, 50), get_histogram_percentile(wait, 99), get_histogram_max(wait), get_histogram_percentile(turnaround, 50), get_histogram_percentile(turnaround, 99), get_histogram_percentile(turnaround, 99.9), get_histogram_max(turnaround),
+                get_avg_memory_utilization(stat), get_avg_internal_fragmentation(stat), get_avg_alignment_padding(stat), stat->compactions, stat->compaction_moved_size);
+    }
+    fflush(stream);
+}
+
+void free_sweep(struct sweep* sweep) {
+    for (int i = 0; i < sweep->size; i++)
+        free(sweep->runs[i].stat);
+    free(sweep->runs);
+    free(sweep);
+}
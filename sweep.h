@@ -0,0 +1,68 @@
+#ifndef CS303_SWEEP_H
+#define CS303_SWEEP_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "arrival.h"
+#include "compaction.h"
+#include "ds.h"
+#include "scheduling.h"
+#include "simulator.h"
+
+#define NUM_SWEEP_PARAMETERS (10)
+
+/*
+One event-driven simulation of a sweep, it owns all of its state so runs can go on in parallel
+*/
+struct sweep_run {
+    int p;
+    int q;
+    int n;
+    int m;
+    int t;
+    int T;
+    int MAX_QUEUE_SIZE;
+    enum placement_algo algo;
+    unsigned int seed;
+    enum scheduling_policy scheduling;
+    float r;  // Drawn from `seed` when the run starts
+    struct compaction_policy compaction;
+    struct stats* stat;
+};
+
+struct sweep {
+    const char* replay_path;        // Trace every run takes its arrivals from, NULL to generate them from the seed
+    struct arrival_model arrivals;  // Shape of the generated arrivals of every run
+    struct block_layout layout;     // Granularity of the memory of every run
+    struct sweep_run* runs;
+    int size;
+    int capacity;
+};
+
+struct sweep* get_new_sweep();
+
+/*
+Adds a run for every combination of the values in `line`
+`line` holds p, q, n, m, t, T, max queue size, placement algorithm and seed, like the interactive input plus the seed,
+optionally followed by the scheduling policy, FIFO if left out
+Each of them is a comma separated list of values or inclusive ranges, e.g. "1000 200 10 10 10 1 10 0,1,2-5 1-100 0-3"
+Returns false, adding nothing, if the line is malformed or a combination is not a valid configuration
+*/
+bool add_sweep_grid(struct sweep* sweep, const char* line, struct compaction_policy* compaction);
+
+/*
+Runs every simulation of the sweep on a work-stealing pool of `num_threads` workers
+Each run replaying a trace maps it on its own, the kernel shares the pages between them
+The log level is process-wide, so the sweep mutes every log of the process until its runs are over
+*/
+void run_sweep(struct sweep* sweep, int num_threads);
+
+/*
+Writes a CSV header and one row per run, in the order the runs were added
+*/
+void write_sweep_csv(struct sweep* sweep, FILE* stream);
+
+void free_sweep(struct sweep* sweep);
+
+#endif
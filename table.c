@@ -0,0 +1,365 @@
+#include "table.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ds.h"
+#include "logger.h"
+
+#define INITIAL_MAX_LEAVES (16)
+#define MERGED_LEAF_CAPACITY (TABLE_LEAF_CAPACITY / 2)  // Neighbouring leaves are merged once both fit in half a leaf
+
+struct memory* get_new_table_memory(uint64_t p, uint64_t q) {
+    struct block_layout layout;
+    init_block_layout(&layout, 1, 1);
+    return get_new_table_memory_with_layout(p, q, &layout);
+}
+
+struct table_leaf* get_new_table_leaf() {
+    return (struct table_leaf*)calloc(1, sizeof(struct table_leaf));
+}
+
+/*
+Refreshes the first address and the largest free size of leaf `l`
+*/
+void update_table_leaf(struct partition_table* table, int l) {
+    struct table_leaf* leaf = table->leaves[l];
+    uint64_t largest = 0;
+    for (uint64_t free_bits = leaf->free_bits; free_bits != 0; free_bits &= free_bits - 1) {
+        uint64_t size = leaf->sizes[__builtin_ctzll(free_bits)];
+        if (size > largest)
+            largest = size;
+    }
+    table->first_addresses[l] = leaf->addresses[0];
+    table->largest_free_sizes[l] = largest;
+}
+
+void insert_table_leaf(struct partition_table* table, int l, struct table_leaf* leaf) {
+    if (table->num_leaves == table->max_leaves) {
+        table->max_leaves *= 2;
+        table->leaves = (struct table_leaf**)realloc(table->leaves, table->max_leaves * sizeof(struct table_leaf*));
+        table->first_addresses = (uint64_t*)realloc(table->first_addresses, table->max_leaves * sizeof(uint64_t));
+        table->largest_free_sizes = (uint64_t*)realloc(table->largest_free_sizes, table->max_leaves * sizeof(uint64_t));
+    }
+    int moved = table->num_leaves - l;
+    memmove(table->leaves + l + 1, table->leaves + l, moved * sizeof(struct table_leaf*));
+    memmove(table->first_addresses + l + 1, table->first_addresses + l, moved * sizeof(uint64_t));
+    memmove(table->largest_free_sizes + l + 1, table->largest_free_sizes + l, moved * sizeof(uint64_t));
+    table->leaves[l] = leaf;
+    table->num_leaves += 1;
+    update_table_leaf(table, l);
+}
+
+void remove_table_leaf(struct partition_table* table, int l) {
+    free(table->leaves[l]);
+    int moved = table->num_leaves - l - 1;
+    memmove(table->leaves + l, table->leaves + l + 1, moved * sizeof(struct table_leaf*));
+    memmove(table->first_addresses + l, table->first_addresses + l + 1, moved * sizeof(uint64_t));
+    memmove(table->largest_free_sizes + l, table->largest_free_sizes + l + 1, moved * sizeof(uint64_t));
+    table->num_leaves -= 1;
+}
+
+/*
+Inserts an entry before entry `i` of leaf `l`, a full leaf is split in two halves first
+*/
+void insert_table_entry(struct partition_table* table, int l, int i, uint64_t address, uint64_t size, bool is_free) {
+    struct table_leaf* leaf = table->leaves[l];
+    if (leaf->count == TABLE_LEAF_CAPACITY) {
+        int half = TABLE_LEAF_CAPACITY / 2;
+        struct table_leaf* upper = get_new_table_leaf();
+        memcpy(upper->addresses, leaf->addresses + half, half * sizeof(uint64_t));
+        memcpy(upper->sizes, leaf->sizes + half, half * sizeof(uint64_t));
+        upper->free_bits = leaf->free_bits >> half;
+        upper->count = half;
+        leaf->free_bits &= (1ULL << half) - 1;
+        leaf->count = half;
+        insert_table_leaf(table, l + 1, upper);
+        update_table_leaf(table, l);
+        if (i > half) {
+            l += 1;
+            i -= half;
+            leaf = upper;
+        }
+    }
+    memmove(leaf->addresses + i + 1, leaf->addresses + i, (leaf->count - i) * sizeof(uint64_t));
+    memmove(leaf->sizes + i + 1, leaf->sizes + i, (leaf->count - i) * sizeof(uint64_t));
+    uint64_t below = leaf->free_bits & ((1ULL << i) - 1);
+    leaf->free_bits = below | ((leaf->free_bits & ~below) << 1) | ((uint64_t)is_free << i);
+    leaf->addresses[i] = address;
+    leaf->sizes[i] = size;
+    leaf->count += 1;
+    update_table_leaf(table, l);
+}
+
+/*
+Appends leaf `l + 1` to leaf `l`, their entries fit in one leaf
+*/
+void merge_table_leaves(struct partition_table* table, int l) {
+    struct table_leaf* leaf = table->leaves[l];
+    struct table_leaf* next = table->leaves[l + 1];
+    memcpy(leaf->addresses + leaf->count, next->addresses, next->count * sizeof(uint64_t));
+    memcpy(leaf->sizes + leaf->count, next->sizes, next->count * sizeof(uint64_t));
+    leaf->free_bits |= next->free_bits << leaf->count;
+    leaf->count += next->count;
+    remove_table_leaf(table, l + 1);
+    update_table_leaf(table, l);
+}
+
+/*
+Removes entry `i` of leaf `l`, entries of other leaves may move to another leaf
+*/
+void remove_table_entry(struct partition_table* table, int l, int i) {
+    struct table_leaf* leaf = table->leaves[l];
+    memmove(leaf->addresses + i, leaf->addresses + i + 1, (leaf->count - i - 1) * sizeof(uint64_t));
+    memmove(leaf->sizes + i, leaf->sizes + i + 1, (leaf->count - i - 1) * sizeof(uint64_t));
+    uint64_t below = (1ULL << i) - 1;
+    leaf->free_bits = (leaf->free_bits & below) | ((leaf->free_bits >> 1) & ~below);
+    leaf->count -= 1;
+    if (leaf->count == 0)
+        remove_table_leaf(table, l);
+    else if (l + 1 < table->num_leaves && leaf->count + table->leaves[l + 1]->count <= MERGED_LEAF_CAPACITY)
+        merge_table_leaves(table, l);
+    else if (l > 0 && table->leaves[l - 1]->count + leaf->count <= MERGED_LEAF_CAPACITY)
+        merge_table_leaves(table, l - 1);
+    else
+        update_table_leaf(table, l);
+}
+
+struct memory* get_new_table_memory_with_layout(uint64_t p, uint64_t q, struct block_layout* layout) {
+    struct memory* mem = get_new_memory_with_layout(p, q, layout);
+    struct partition_table* table = (struct partition_table*)malloc(sizeof(struct partition_table));
+    table->max_leaves = INITIAL_MAX_LEAVES;
+    table->leaves = (struct table_leaf**)malloc(table->max_leaves * sizeof(struct table_leaf*));
+    table->first_addresses = (uint64_t*)malloc(table->max_leaves * sizeof(uint64_t));
+    table->largest_free_sizes = (uint64_t*)malloc(table->max_leaves * sizeof(uint64_t));
+    table->num_leaves = 0;
+    table->cursor = 0;
+    mem->table = table;
+
+    // Free space only lives in the table
+    uint64_t size = mem->head->size;
+    remove_free_partition(mem, mem->head);
+    free_partition(mem, mem->head);
+    mem->head = NULL;
+    if (size > 0) {
+        insert_table_leaf(table, 0, get_new_table_leaf());
+        insert_table_entry(table, 0, 0, 0, size, true);
+        mem->free_size = size;
+        mem->free_partitions = 1;
+    }
+    return mem;
+}
+
+/*
+Index of the last of the `count` sorted `addresses` that is at most `address`, -1 if there is none
+*/
+int find_last_at_most(const uint64_t* addresses, int count, uint64_t address) {
+    int low = 0, high = count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (addresses[middle] <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low - 1;
+}
+
+bool find_table_entry(struct partition_table* table, uint64_t address, int* leaf, int* index) {
+    if (table->num_leaves == 0)
+        return false;
+    int l = find_last_at_most(table->first_addresses, table->num_leaves, address);
+    if (l < 0)
+        l = 0;
+    int i = find_last_at_most(table->leaves[l]->addresses, table->leaves[l]->count, address);
+    *leaf = l;
+    *index = i < 0 ? 0 : i;
+    return true;
+}
+
+/*
+First leaf in [from, to) with a free entry of at least `size` bytes, `to` if there is none
+The largest free sizes are compared four at a time without branching, which the compiler vectorizes
+*/
+int skip_table_leaves(const uint64_t* largest_free_sizes, int from, int to, uint64_t size) {
+    while (from + 4 <= to && ((largest_free_sizes[from] < size) & (largest_free_sizes[from + 1] < size) & (largest_free_sizes[from + 2] < size) & (largest_free_sizes[from + 3] < size)))
+        from += 4;
+    while (from < to && largest_free_sizes[from] < size)
+        from++;
+    return from;
+}
+
+bool find_table_entry_at_least(struct partition_table* table, int from_leaf, int from_index, int to_leaf, int to_index, uint64_t size, int* leaf, int* index) {
+    int end = to_leaf < table->num_leaves ? to_leaf + 1 : table->num_leaves;
+    for (int l = skip_table_leaves(table->largest_free_sizes, from_leaf, end, size); l < end; l = skip_table_leaves(table->largest_free_sizes, l + 1, end, size)) {
+        struct table_leaf* t = table->leaves[l];
+        int from = l == from_leaf ? from_index : 0;
+        int to = l == to_leaf ? to_index : t->count;
+        if (from >= to)
+            continue;
+        uint64_t in_range = (to == TABLE_LEAF_CAPACITY ? ~0ULL : (1ULL << to) - 1) & (~0ULL << from);
+        for (uint64_t free_bits = t->free_bits & in_range; free_bits != 0; free_bits &= free_bits - 1) {
+            int i = __builtin_ctzll(free_bits);
+            if (t->sizes[i] >= size) {
+                *leaf = l;
+                *index = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+Allocates the start of free entry `i` of leaf `l` to a block of `block_size` bytes
+The rest is split off as in allocate_partition()
+*/
+struct partition* allocate_table_entry(struct memory* mem, int l, int i, uint64_t block_size, uint64_t process_size) {
+    struct partition_table* table = mem->table;
+    struct table_leaf* leaf = table->leaves[l];
+    uint64_t address = leaf->addresses[i];
+    uint64_t size = leaf->sizes[i];
+    uint64_t rest_size = size - block_size;
+    leaf->free_bits &= ~(1ULL << i);
+    mem->free_size -= size;
+    mem->free_partitions -= 1;
+    if (rest_size > 0 && rest_size >= get_block_size(mem, 0)) {
+        size = block_size;
+        leaf->sizes[i] = size;
+        insert_table_entry(table, l, i + 1, address + size, rest_size, true);
+        mem->free_size += rest_size;
+        mem->free_partitions += 1;
+    } else {
+        update_table_leaf(table, l);
+    }
+    struct partition* part = get_new_memory_partition(mem, NULL, NULL, address, size, true);
+    mark_partition_allocated(mem, part, process_size);
+    return part;
+}
+
+struct partition* table_first_fit(struct memory* mem, uint64_t process_size) {
+    struct partition_table* table = mem->table;
+    uint64_t block_size = get_block_size(mem, process_size);
+    int l, i;
+    if (!find_table_entry_at_least(table, 0, 0, table->num_leaves, 0, block_size, &l, &i)) return NULL;
+    return allocate_table_entry(mem, l, i, block_size, process_size);
+}
+
+struct partition* table_best_fit(struct memory* mem, uint64_t process_size) {
+    struct partition_table* table = mem->table;
+    uint64_t block_size = get_block_size(mem, process_size);
+    int best_leaf = -1, best_index = 0;
+    uint64_t best_size = 0;
+    for (int l = skip_table_leaves(table->largest_free_sizes, 0, table->num_leaves, block_size); l < table->num_leaves; l = skip_table_leaves(table->largest_free_sizes, l + 1, table->num_leaves, block_size)) {
+        struct table_leaf* leaf = table->leaves[l];
+        for (uint64_t free_bits = leaf->free_bits; free_bits != 0; free_bits &= free_bits - 1) {
+            int i = __builtin_ctzll(free_bits);
+            uint64_t size = leaf->sizes[i];
+            if (size >= block_size && (best_leaf < 0 || size < best_size)) {
+                best_leaf = l;
+                best_index = i;
+                best_size = size;
+            }
+        }
+        if (best_size == block_size) break;
+    }
+    if (best_leaf < 0) return NULL;
+    return allocate_table_entry(mem, best_leaf, best_index, block_size, process_size);
+}
+
+struct partition* table_next_fit(struct memory* mem, uint64_t process_size) {
+    struct partition_table* table = mem->table;
+    uint64_t block_size = get_block_size(mem, process_size);
+    int start_leaf, start_index, l, i;
+    if (!find_table_entry(table, table->cursor, &start_leaf, &start_index)) return NULL;
+    if (!find_table_entry_at_least(table, start_leaf, start_index, table->num_leaves, 0, block_size, &l, &i) &&
+        !find_table_entry_at_least(table, 0, 0, start_leaf, start_index, block_size, &l, &i))
+        return NULL;
+    table->cursor = table->leaves[l]->addresses[i];
+    return allocate_table_entry(mem, l, i, block_size, process_size);
+}
+
+/*
+First leaf holding a largest free entry, -1 if there is no free entry
+*/
+int find_largest_table_leaf(struct partition_table* table) {
+    int largest_leaf = -1;
+    uint64_t largest_size = 0;
+    for (int l = 0; l < table->num_leaves; l++) {
+        if (table->largest_free_sizes[l] > largest_size) {
+            largest_leaf = l;
+            largest_size = table->largest_free_sizes[l];
+        }
+    }
+    return largest_leaf;
+}
+
+struct partition* table_worst_fit(struct memory* mem, uint64_t process_size) {
+    struct partition_table* table = mem->table;
+    uint64_t block_size = get_block_size(mem, process_size);
+    int l = find_largest_table_leaf(table), i;
+    if (l < 0 || table->largest_free_sizes[l] < block_size) return NULL;
+    find_table_entry_at_least(table, l, 0, l, table->leaves[l]->count, table->largest_free_sizes[l], &l, &i);
+    return allocate_table_entry(mem, l, i, block_size, process_size);
+}
+
+void deallocate_table_partition(struct memory* mem, struct partition* part) {
+    struct partition_table* table = mem->table;
+    int l, i;
+    find_table_entry(table, part->address, &l, &i);
+    struct table_leaf* leaf = table->leaves[l];
+    leaf->free_bits |= 1ULL << i;
+    mem->free_size += part->size;
+    mem->free_partitions += 1;
+    // Merging into the next entry first keeps this entry where it is unless its leaf is merged into the previous one
+    int next_leaf = i + 1 < leaf->count ? l : l + 1;
+    int next_index = i + 1 < leaf->count ? i + 1 : 0;
+    if (next_leaf < table->num_leaves && (table->leaves[next_leaf]->free_bits >> next_index) & 1) {
+        leaf->sizes[i] += table->leaves[next_leaf]->sizes[next_index];
+        remove_table_entry(table, next_leaf, next_index);
+        mem->free_partitions -= 1;
+        find_table_entry(table, part->address, &l, &i);
+        leaf = table->leaves[l];
+    }
+    int prev_leaf = i > 0 ? l : l - 1;
+    int prev_index = i > 0 ? i - 1 : (l > 0 ? table->leaves[l - 1]->count - 1 : 0);
+    if (prev_leaf >= 0 && (table->leaves[prev_leaf]->free_bits >> prev_index) & 1) {
+        table->leaves[prev_leaf]->sizes[prev_index] += leaf->sizes[i];
+        update_table_leaf(table, prev_leaf);
+        remove_table_entry(table, l, i);
+        mem->free_partitions -= 1;
+    } else {
+        update_table_leaf(table, l);
+    }
+    free_partition(mem, part);
+}
+
+uint64_t get_largest_free_table_entry_size(struct memory* mem) {
+    struct partition_table* table = mem->table;
+    int l = find_largest_table_leaf(table);
+    return l < 0 ? 0 : table->largest_free_sizes[l];
+}
+
+void print_table_memory(struct memory* mem) {
+    struct partition_table* table = mem->table;
+    log_info("┌────────────┐");
+    for (int l = 0; l < table->num_leaves; l++) {
+        struct table_leaf* leaf = table->leaves[l];
+        for (int i = 0; i < leaf->count; i++) {
+            if (l > 0 || i > 0)
+                log_info("├────────────┤");
+            log_info("│ %s %8.1f │", (leaf->free_bits >> i) & 1 ? " " : "✓", get_size_in_mb(leaf->sizes[i]));
+        }
+    }
+    log_info("└────────────┘");
+}
+
+void free_partition_table(struct partition_table* table) {
+    for (int l = 0; l < table->num_leaves; l++)
+        free(table->leaves[l]);
+    free(table->leaves);
+    free(table->first_addresses);
+    free(table->largest_free_sizes);
+    free(table);
+}
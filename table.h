@@ -0,0 +1,92 @@
+#ifndef CS303_TABLE_H
+#define CS303_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ds.h"
+
+#define TABLE_LEAF_CAPACITY (64)  // Entries per leaf, the free bits of a leaf fit in one word
+
+/*
+Consecutive partitions of a table, ordered by address
+*/
+struct table_leaf {
+    uint64_t addresses[TABLE_LEAF_CAPACITY];
+    uint64_t sizes[TABLE_LEAF_CAPACITY];
+    uint64_t free_bits;  // Bit i is set iff entry i is free
+    int count;
+};
+
+/*
+Structure of arrays representation of a memory, there is no partition list and only allocated partitions exist
+Every partition, free or allocated, is an entry of a leaf, leaves are split when full and merged when sparse like
+the leaves of a B+ tree, so splitting and merging partitions only moves entries within a leaf
+The per leaf arrays are contiguous, a partition is looked up by a binary search on the first addresses and another
+within its leaf, and searches skip every leaf whose largest free entry is too small
+*/
+struct partition_table {
+    struct table_leaf** leaves;    // Ordered by address
+    uint64_t* first_addresses;     // Address of the first entry of each leaf
+    uint64_t* largest_free_sizes;  // Size of the largest free entry of each leaf, 0 if it has none
+    int num_leaves;
+    int max_leaves;
+    uint64_t cursor;  // Address within the entry where the next table_next_fit() resumes
+};
+
+/*
+Memory whose p - q bytes are tracked by a partition table
+Partitions of this memory must only be allocated by table_first_fit(), table_best_fit(), table_next_fit() or table_worst_fit()
+*/
+struct memory* get_new_table_memory(uint64_t p, uint64_t q);
+
+/*
+Same as get_new_table_memory() with the granularity of `layout`
+*/
+struct memory* get_new_table_memory_with_layout(uint64_t p, uint64_t q, struct block_layout* layout);
+
+/*
+Finds the entry holding `address`
+Returns false if the table is empty
+*/
+bool find_table_entry(struct partition_table* table, uint64_t address, int* leaf, int* index);
+
+/*
+First free entry of at least `size` bytes in [(from_leaf, from_index), (to_leaf, to_index))
+Returns false if there is none
+*/
+bool find_table_entry_at_least(struct partition_table* table, int from_leaf, int from_index, int to_leaf, int to_index, uint64_t size, int* leaf, int* index);
+
+/*
+Lowest addressed free entry that holds the process
+*/
+struct partition* table_first_fit(struct memory* mem, uint64_t process_size);
+
+/*
+Smallest free entry that holds the process, the lowest addressed of them on ties
+*/
+struct partition* table_best_fit(struct memory* mem, uint64_t process_size);
+
+/*
+First fit resuming from the entry holding `cursor`, wrapping around to the start once
+*/
+struct partition* table_next_fit(struct memory* mem, uint64_t process_size);
+
+/*
+The lowest addressed of the largest free entries
+*/
+struct partition* table_worst_fit(struct memory* mem, uint64_t process_size);
+
+/*
+Marks the entry of the freed partition free, merges it with its free neighbours and releases the partition
+Called by deallocate_partition() once `part` is marked free
+*/
+void deallocate_table_partition(struct memory* mem, struct partition* part);
+
+uint64_t get_largest_free_table_entry_size(struct memory* mem);
+
+void print_table_memory(struct memory* mem);
+
+void free_partition_table(struct partition_table* table);
+
+#endif
@@ -1,9 +1,36 @@
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
+#include <unistd.h>
 
+#include "../arena.h"
+#include "../arrival.h"
+#include "../backfill.h"
+#include "../bitmap.h"
+#include "../buddy.h"
+#include "../compaction.h"
+#include "../completion_service.h"
 #include "../ds.h"
+#include "../event_simulator.h"
+#include "../heap.h"
+#include "../helper.h"
+#include "../histogram.h"
 #include "../logger.h"
+#include "../pool.h"
+#include "../rng.h"
+#include "../scheduling.h"
+#include "../shard.h"
+#include "../sweep.h"
+#include "../table.h"
+#include "../thread_pool.h"
+#include "../trace.h"
 
 int total_tests = 0;
 int passed_tests = 0;
@@ -24,6 +51,58 @@ void print_test_section(char* section) {
     printf("\n\033[0;1m%s\033[0m\n\n", section);
 }
 
+bool are_memory_counters_consistent(struct memory* mem) {
+    uint64_t used_size = 0, free_size = 0, largest_free_size = 0;
+    int free_partitions = 0, allocated_partitions = 0;
+    for (struct partition* part = mem->head; part != NULL; part = part->next) {
+        if (part->is_free) {
+            free_size += part->size;
+            free_partitions++;
+            if (part->size > largest_free_size) largest_free_size = part->size;
+        } else {
+            used_size += part->size;
+            allocated_partitions++;
+        }
+    }
+    return mem->used_size == used_size && mem->free_size == free_size && mem->free_partitions == free_partitions && mem->allocated_partitions == allocated_partitions && get_largest_free_partition_size(mem) == largest_free_size;
+}
+
+int count_free_tree(struct partition* node, struct partition** prev, bool* ordered) {
+    if (node == NULL) return 0;
+    int count = count_free_tree(node->tree_left, prev, ordered);
+    if (*prev != NULL && !((*prev)->size < node->size || ((*prev)->size == node->size && (*prev)->address < node->address)))
+        *ordered = false;
+    *prev = node;
+    return count + 1 + count_free_tree(node->tree_right, prev, ordered);
+}
+
+bool is_free_list_index_consistent(struct memory* mem) {
+    int free_partitions = 0;
+    for (struct partition* part = mem->head; part != NULL; part = part->next) {
+        if (!part->is_free) continue;
+        free_partitions++;
+        int size_class = get_size_class(part->size);
+        struct partition* iter = mem->free_lists[size_class][get_size_subclass(part->size, size_class)];
+        while (iter != NULL && iter != part) iter = iter->next_free;
+        if (iter == NULL) return false;
+    }
+    int indexed_partitions = 0;
+    for (int i = 0; i < NUM_SIZE_CLASSES; i++) {
+        for (int j = 0; j < NUM_SIZE_SUBCLASSES; j++) {
+            bool is_marked = ((mem->size_class_bitmap >> i) & 1) && ((mem->size_subclass_bitmaps[i] >> j) & 1);
+            if (is_marked != (mem->free_lists[i][j] != NULL)) return false;
+            for (struct partition* iter = mem->free_lists[i][j]; iter != NULL; iter = iter->next_free) {
+                if (!iter->is_free || get_size_class(iter->size) != i || get_size_subclass(iter->size, i) != j) return false;
+                indexed_partitions++;
+            }
+        }
+    }
+    struct partition* prev = NULL;
+    bool ordered = true;
+    int tree_partitions = count_free_tree(mem->free_tree, &prev, &ordered);
+    return free_partitions == indexed_partitions && free_partitions == tree_partitions && ordered && are_memory_counters_consistent(mem);
+}
+
 void test_process_and_memory() {
     {
         struct partition* part = get_new_partition(NULL, NULL, 10, true);
@@ -34,13 +113,13 @@ void test_process_and_memory() {
     test_log("New memory", mem->p == 100 && mem->q == 10 && mem->head->size == 90 && mem->head->is_free);
 
     {
-        struct partition* part = allocate_partition(mem->head, mem->p);
+        struct partition* part = allocate_partition(mem, mem->head, mem->p);
         test_log("Allocate on partition (1/2)", part == NULL);
     }
 
     {
         int size = 50;
-        struct partition* part = allocate_partition(mem->head, size);
+        struct partition* part = allocate_partition(mem, mem->head, size);
         test_log("Allocate on partition (2/2)", part == mem->head && part->is_free == false && part->size == size && part->next->size == (mem->p - mem->q - size) && part->next->is_free);
     }
 
@@ -50,17 +129,18 @@ void test_process_and_memory() {
     }
 
     {
-        allocate_partition(mem->head, 5);
-        allocate_partition(mem->head->next, 10);
-        allocate_partition(mem->head->next->next, 6);
-        allocate_partition(mem->head->next->next->next, 8);
-        allocate_partition(mem->head->next->next->next->next, 4);
-        allocate_partition(mem->head->next->next->next->next->next, 20);
+        allocate_partition(mem, mem->head, 5);
+        allocate_partition(mem, mem->head->next, 10);
+        allocate_partition(mem, mem->head->next->next, 6);
+        allocate_partition(mem, mem->head->next->next->next, 8);
+        allocate_partition(mem, mem->head->next->next->next->next, 4);
+        allocate_partition(mem, mem->head->next->next->next->next->next, 20);
         print_memory(mem);
         deallocate_partition(mem->head->next);
         deallocate_partition(mem->head->next->next->next);
         deallocate_partition(mem->head->next->next->next->next->next);
         print_memory(mem);
+        test_log("Free list index after deallocation", is_free_list_index_consistent(mem) && mem->head->next->next->next->address == 21);
 
         {
             print_memory(mem);
@@ -88,6 +168,8 @@ void test_process_and_memory() {
             next_fit(mem, 3, 100 - 10 - 42 + 1);
             test_log("Next fit (2/2)", part->size == 3 && part->is_free == false);
         }
+
+        test_log("Free list index after placement", is_free_list_index_consistent(mem));
     }
 
     {
@@ -104,44 +186,1038 @@ void test_process_and_memory() {
         log_debug("Usage: %f", usage);
         test_log("Memory utilization check (2/2)", usage == 46);
     }
+
+    {
+        float fragmentation = get_percentage_external_fragmentation(mem);
+        test_log("Memory counters", is_free_list_index_consistent(mem) && get_largest_free_partition_size(mem) == 42 && fragmentation > 22.2f && fragmentation < 22.3f);
+    }
+}
+
+void test_roving_next_fit() {
+    struct memory* mem = get_new_empty_memory(100, 10);
+    struct partition* first = roving_next_fit(mem, 10);
+    roving_next_fit(mem, 10);
+    struct partition* third = roving_next_fit(mem, 10);
+    deallocate_partition(first);
+    struct partition* part = roving_next_fit(mem, 5);
+    test_log("Roving next fit resumes from cursor", part != NULL && part->address == 30 && get_address_of_partition(part) == 30);
+
+    deallocate_partition(third);
+    deallocate_partition(part);
+    test_log("Roving cursor survives coalescing", mem->cursor != NULL && mem->cursor->is_free && mem->cursor->address == 20);
+
+    part = roving_next_fit(mem, 70);
+    test_log("Roving next fit wraps around", part != NULL && part->address == 20 && mem->cursor == part);
+    free_memory(mem);
+}
+
+void test_worst_fit_and_tlsf() {
+    struct memory* mem = get_new_empty_memory(200, 0);
+    struct partition* parts[6];
+    int sizes[] = {40, 10, 18, 10, 40, 10};
+    for (int i = 0; i < 6; i++)
+        parts[i] = first_fit(mem, sizes[i]);
+    deallocate_partition(parts[0]);
+    deallocate_partition(parts[2]);
+    deallocate_partition(parts[4]);
+    // Free: 40 at 0, 18 at 50, 40 at 78, 72 at 128
+
+    struct partition* part = worst_fit(mem, 32);
+    test_log("Worst fit takes the largest partition", part != NULL && part->address == 128 && part->size == 32);
+    part = worst_fit(mem, 5);
+    test_log("Worst fit prefers the lowest address among the largest", part != NULL && part->address == 0);
+    test_log("Worst fit fails when nothing is large enough", worst_fit(mem, 41) == NULL);
+    // Free: 35 at 5, 18 at 50, 40 at 78, 40 at 160
+
+    part = tlsf_fit(mem, 17);
+    test_log("TLSF takes a partition from the first subclass that always fits", part != NULL && part->address == 50);
+    part = tlsf_fit(mem, 36);
+    test_log("TLSF skips subclasses that may not fit", part != NULL && (part->address == 78 || part->address == 160));
+    test_log("TLSF fails when nothing is large enough", tlsf_fit(mem, 41) == NULL);
+    test_log("Size subclass index after TLSF", is_free_list_index_consistent(mem));
+    free_memory(mem);
+}
+
+void test_buddy() {
+    struct memory* mem = get_new_buddy_memory(100, 20);
+    test_log("Buddy memory is carved into power-of-two blocks", mem->head->size == 64 && mem->head->next->size == 16 && mem->head->next->address == 64 && mem->free_partitions == 2);
+
+    struct partition* a = buddy_fit(mem, 10);
+    test_log("Buddy fit takes an exact order block", a != NULL && a->address == 64 && a->size == 16 && !a->is_free);
+
+    struct partition* b = buddy_fit(mem, 5);
+    test_log("Buddy fit splits larger blocks", b != NULL && b->address == 0 && b->size == 8 && mem->free_lists[3][0] != NULL && mem->free_lists[4][0] != NULL && mem->free_lists[5][0] != NULL);
+    test_log("Buddy internal fragmentation", get_percentage_internal_fragmentation(mem) > 37.4f && get_percentage_internal_fragmentation(mem) < 37.6f && is_free_list_index_consistent(mem));
+
+    test_log("Buddy fit fails without a large enough block", buddy_fit(mem, 40) == NULL);
+
+    deallocate_partition(b);
+    test_log("Buddy blocks coalesce on free", mem->head->size == 64 && mem->head->is_free && mem->free_partitions == 1 && is_free_list_index_consistent(mem));
+
+    deallocate_partition(a);
+    test_log("Buddy blocks do not coalesce across top level blocks", mem->free_partitions == 2 && mem->head->next->size == 16 && mem->head->next->is_free);
+    free_memory(mem);
+
+    struct block_layout layout;
+    init_block_layout(&layout, 4096, 4096);
+    mem = get_new_buddy_memory_with_layout(5000, 1000, &layout);
+    test_log("Buddy memory smaller than one block fails every allocation", mem->free_size == 0 && mem->free_partitions == 0 && mem->q == 5000 && buddy_fit(mem, 1) == NULL);
+    free_memory(mem);
+}
+
+void test_compaction() {
+    struct memory* mem = get_new_empty_memory(100, 0);
+    struct partition* parts[5];
+    for (int i = 0; i < 5; i++)
+        parts[i] = first_fit(mem, 15);
+    deallocate_partition(parts[0]);
+    deallocate_partition(parts[2]);
+    // Free: 15 at 0, 15 at 30, 25 at 75
+
+    struct compaction_policy* policy = get_new_compaction_policy(COMPACTION_ON_FAILURE, 0, 0, 1000);
+    test_log("Compaction triggers when free memory would hold the process", first_fit(mem, 40) == NULL && should_compact_after_failure(policy, mem, 40) && !should_compact_after_failure(policy, mem, 60));
+
+    struct stats* stat = get_empty_stats();
+    long time_in_millis = compact_and_record(policy, mem, stat, 0);
+    test_log("Compaction slides allocated partitions down", parts[1]->address == 0 && parts[3]->address == 15 && parts[4]->address == 30 && get_address_of_partition(parts[4]) == 30);
+    test_log("Compaction leaves a single hole", mem->free_partitions == 1 && mem->head->next->next->next->is_free && mem->head->next->next->next->size == 55 && are_memory_counters_consistent(mem) && is_free_list_index_consistent(mem));
+    test_log("Allocation after compaction", first_fit(mem, 40) != NULL);
+
+    struct memory* large = get_new_empty_memory(100 * BYTES_PER_MB, 0);
+    struct partition* hole = first_fit(large, 15 * BYTES_PER_MB);
+    first_fit(large, 40 * BYTES_PER_MB);
+    deallocate_partition(hole);
+    time_in_millis = compact_and_record(policy, large, stat, 0);
+    test_log("Compaction cost", stat->compactions == 2 && stat->compaction_moved_size == 45 + 40 * BYTES_PER_MB && time_in_millis == 40 && stat->compaction_time_in_millis == 40);
+    free_memory(large);
+
+    policy->trigger = COMPACTION_PERIODIC;
+    policy->period_in_millis = 100;
+    deallocate_partition(parts[1]);
+    test_log("Periodic compaction", !should_compact(policy, mem, 50) && should_compact(policy, mem, 100));
+    policy->trigger = COMPACTION_ON_FRAGMENTATION;
+    policy->fragmentation_threshold = 40;
+    test_log("Fragmentation triggered compaction", should_compact(policy, mem, 0));  // Two 15MB holes, 50% external fragmentation
+
+    struct compaction_policy parsed;
+    test_log("Compaction trigger parsing", parse_compaction_trigger("fragmentation:30", &parsed) && parsed.trigger == COMPACTION_ON_FRAGMENTATION && parsed.fragmentation_threshold == 30 && parse_compaction_trigger("periodic:500", &parsed) && parsed.period_in_millis == 500 && !parse_compaction_trigger("sometimes", &parsed));
+    free(policy);
+    free(stat);
+    free_memory(mem);
+}
+
+void test_alignment() {
+    test_log("Partition fits in a cache line", sizeof(struct partition) <= CACHE_LINE_SIZE);
+
+    struct block_layout layout;
+    init_block_layout(&layout, 16, 64);
+    struct memory* mem = get_new_memory_with_layout(1000, 10, &layout);
+    test_log("Usable memory is a whole number of aligned blocks", mem->q == 24 && mem->head->size == 976);
+
+    struct partition* first = first_fit(mem, 20);
+    struct partition* second = best_fit(mem, 40);
+    test_log("Blocks are rounded up to the minimum block size and the alignment", first->size == 64 && second->address == 64 && second->size == 64 && second->next->address == 128);
+    test_log("Alignment padding is part of the internal fragmentation", mem->padding_size == 20 && get_percentage_alignment_padding(mem) == 15.625f && get_percentage_internal_fragmentation(mem) == 53.125f);
+
+    struct partition* third = tlsf_fit(mem, 800);
+    test_log("Remainders below the minimum block size stay in the block", third->size == 848 && third->next == NULL && third->requested_size == 800 && is_free_list_index_consistent(mem));
+
+    deallocate_partition(second);
+    deallocate_partition(first);
+    deallocate_partition(third);
+    test_log("Padding is released with the partition", mem->padding_size == 0 && mem->requested_size == 0 && mem->free_partitions == 1 && is_free_list_index_consistent(mem));
+    free_memory(mem);
+
+    mem = get_new_empty_memory(1ULL << 40, 0);
+    first = first_fit(mem, 5ULL << 30);
+    second = tlsf_fit(mem, (3ULL << 30) + 1);
+    test_log("Addresses and sizes beyond 4GB", first->size == 5ULL << 30 && second->address == 5ULL << 30 && second->next->address == (8ULL << 30) + 1 && is_free_list_index_consistent(mem));
+    free_memory(mem);
+
+    init_block_layout(&layout, 64, 64);
+    mem = get_new_buddy_memory_with_layout(1000, 0, &layout);
+    first = buddy_fit(mem, 1);
+    test_log("Buddy blocks are no smaller than the alignment", mem->q == 40 && first->size == 64 && first->address == 512 + 256 + 128 && get_percentage_alignment_padding(mem) > 98.4f);
+    free_memory(mem);
+}
+
+void test_bitmap() {
+    struct memory* mem = get_new_bitmap_memory(1000, 10);
+    test_log("Bitmap memory has one unit per block", mem->bitmap->unit_size == 1 && mem->bitmap->num_units == 990 && mem->head == NULL && mem->free_size == 990 && mem->free_partitions == 1);
+    struct partition* first = bitmap_first_fit(mem, 100);
+    struct partition* second = bitmap_first_fit(mem, 50);
+    struct partition* third = bitmap_first_fit(mem, 30);
+    test_log("Bitmap first fit takes the lowest free units", first->address == 0 && second->address == 100 && third->address == 150 && third->size == 30 && mem->used_size == 180 && mem->free_size == 810);
+    deallocate_partition(first);
+    deallocate_partition(third);
+    test_log("Freed bitmap units merge with their free neighbours", mem->free_partitions == 2 && mem->free_size == 940 && get_largest_free_partition_size(mem) == 840);
+    first = bitmap_best_fit(mem, 90);
+    test_log("Bitmap best fit takes the shortest run that holds the process", first->address == 0 && mem->free_partitions == 2 && get_largest_free_partition_size(mem) == 840);
+    struct partition* last = bitmap_next_fit(mem, 5);
+    struct partition* after = bitmap_next_fit(mem, 5);
+    test_log("Bitmap next fit resumes from the last allocation", last->address == 90 && after->address == 95 && mem->bitmap->cursor == 95 && mem->free_partitions == 1);
+    test_log("Bitmap memory fails processes larger than its longest run", bitmap_first_fit(mem, 841) == NULL && bitmap_best_fit(mem, 841) == NULL && bitmap_next_fit(mem, 841) == NULL && bitmap_next_fit(mem, 840)->address == 150);
+    free_memory(mem);
+
+    mem = get_new_bitmap_memory(300, 0);
+    first = bitmap_first_fit(mem, 60);
+    second = bitmap_first_fit(mem, 70);
+    third = bitmap_first_fit(mem, 130);
+    deallocate_partition(second);
+    test_log("Bitmap runs cross word boundaries", second->address == 60 && mem->bitmap->words[0] == (1ULL << 60) - 1 && mem->bitmap->words[1] == 0 && mem->bitmap->words[2] == ~0ULL << 2 && mem->bitmap->words[3] == ~0ULL);
+    deallocate_partition(first);
+    deallocate_partition(third);
+    test_log("Bitmap memory frees every unit", mem->free_partitions == 1 && mem->bitmap->words[0] == 0 && mem->bitmap->words[3] == 0 && mem->bitmap->words[4] == ~0ULL << 44 && get_largest_free_partition_size(mem) == 300);
+    free_memory(mem);
+
+    struct block_layout layout;
+    init_block_layout(&layout, 4096, 4096);
+    mem = get_new_memory_for_algo(1000 * BYTES_PER_MB + 1000, 200 * BYTES_PER_MB, BITMAP_BEST_FIT, &layout);
+    first = bitmap_best_fit(mem, 5000);
+    test_log("Bitmap units are blocks of the layout", mem->bitmap->unit_size == 4096 && mem->bitmap->num_units == 800 * 256 && mem->q == 200 * BYTES_PER_MB + 1000 && first->size == 8192 && mem->padding_size == 8192 - 5000);
+    free_memory(mem);
+
+    uint64_t words[300];
+    for (int i = 0; i < 300; i++)
+        words[i] = i % 37 == 36 ? 5 : (i % 53 == 52 ? 0 : (i % 29 == 28 ? ~(0xFFFFULL << 56) : ~0ULL));
+    bool is_consistent = true;
+    for (uint64_t from = 0; from < 300; from += 7) {
+        for (uint64_t to = from; to <= 300; to += 13) {
+            uint64_t expected = skip_bitmap_words(BITMAP_SCAN_SCALAR, words, from, to, ~0ULL);
+            is_consistent &= skip_bitmap_words(BITMAP_SCAN_SSE2, words, from, to, ~0ULL) == expected && skip_bitmap_words(BITMAP_SCAN_AVX2, words, from, to, ~0ULL) == expected;
+            expected = skip_bitmap_words(BITMAP_SCAN_SCALAR, words, from, to, 0);
+            is_consistent &= skip_bitmap_words(BITMAP_SCAN_SSE2, words, from, to, 0) == expected && skip_bitmap_words(BITMAP_SCAN_AVX2, words, from, to, 0) == expected;
+            for (uint64_t units = 1; units <= 32; units += 3) {
+                expected = skip_bitmap_words_without_run(BITMAP_SCAN_SCALAR, words, from, to, units);
+                is_consistent &= skip_bitmap_words_without_run(BITMAP_SCAN_SSE2, words, from, to, units) == expected && skip_bitmap_words_without_run(BITMAP_SCAN_AVX2, words, from, to, units) == expected;
+            }
+        }
+    }
+    test_log("Vectorized bitmap scans match the scalar one", is_consistent);
+
+    struct partition* (*list_fits[2])(struct memory*, uint64_t) = {first_fit, best_fit};
+    struct partition* (*bitmap_fits[2])(struct memory*, uint64_t) = {bitmap_first_fit, bitmap_best_fit};
+    bool is_same_placement = true;
+    for (int fit = 0; fit < 2; fit++) {
+        struct memory* list = get_new_empty_memory(5000, 0);
+        struct memory* bitmap = get_new_bitmap_memory(5000, 0);
+        struct partition* list_parts[64] = {NULL};
+        struct partition* bitmap_parts[64] = {NULL};
+        unsigned int seed = 303;
+        for (int i = 0; i < 5000; i++) {
+            int slot = rand_r(&seed) % 64;
+            if (list_parts[slot] != NULL) {
+                deallocate_partition(list_parts[slot]);
+                deallocate_partition(bitmap_parts[slot]);
+            }
+            uint64_t size = 1 + rand_r(&seed) % 150;
+            list_parts[slot] = list_fits[fit](list, size);
+            bitmap_parts[slot] = bitmap_fits[fit](bitmap, size);
+            is_same_placement &= (list_parts[slot] == NULL) == (bitmap_parts[slot] == NULL) && (list_parts[slot] == NULL || list_parts[slot]->address == bitmap_parts[slot]->address);
+            is_same_placement &= list->free_partitions == bitmap->free_partitions && get_largest_free_partition_size(list) == get_largest_free_partition_size(bitmap);
+        }
+        free_memory(list);
+        free_memory(bitmap);
+    }
+    test_log("Bitmap first and best fit place like the partition list", is_same_placement);
+}
+
+void test_table() {
+    struct memory* mem = get_new_table_memory(1000, 10);
+    test_log("Table memory starts as one free entry", mem->table->num_leaves == 1 && mem->table->leaves[0]->count == 1 && mem->head == NULL && mem->free_size == 990 && mem->free_partitions == 1);
+    struct partition* first = table_first_fit(mem, 100);
+    struct partition* second = table_first_fit(mem, 50);
+    struct partition* third = table_first_fit(mem, 30);
+    test_log("Table first fit splits the lowest free entry", first->address == 0 && second->address == 100 && third->address == 150 && mem->table->leaves[0]->count == 4 && mem->table->leaves[0]->free_bits == 1ULL << 3 && mem->free_size == 810);
+    deallocate_partition(first);
+    deallocate_partition(third);
+    test_log("Freed table entries merge with their free neighbours", mem->table->leaves[0]->count == 3 && mem->free_partitions == 2 && mem->free_size == 940 && get_largest_free_partition_size(mem) == 840);
+    first = table_best_fit(mem, 90);
+    test_log("Table best fit takes the smallest free entry that holds the process", first->address == 0 && mem->free_partitions == 2);
+    struct partition* last = table_next_fit(mem, 5);
+    struct partition* after = table_next_fit(mem, 5);
+    test_log("Table next fit resumes from the last allocation", last->address == 90 && after->address == 95 && mem->table->cursor == 95 && mem->free_partitions == 1);
+    test_log("Table worst fit takes the largest free entry", table_worst_fit(mem, 10)->address == 150 && table_worst_fit(mem, 831) == NULL && table_first_fit(mem, 831) == NULL && table_best_fit(mem, 831) == NULL);
+    free_memory(mem);
+
+    mem = get_new_table_memory(10000, 0);
+    struct partition* parts[200];
+    for (int i = 0; i < 200; i++)
+        parts[i] = table_first_fit(mem, 10);
+    int leaf, index;
+    bool is_found = find_table_entry(mem->table, 1234, &leaf, &index) && mem->table->leaves[leaf]->addresses[index] == 1230;
+    test_log("Full table leaves are split and entries are found by address", mem->table->num_leaves > 200 / TABLE_LEAF_CAPACITY && is_found);
+    for (int i = 0; i < 200; i++)
+        deallocate_partition(parts[i]);
+    test_log("Table leaves are merged once their entries are freed", mem->table->num_leaves == 1 && mem->table->leaves[0]->count == 1 && mem->free_partitions == 1 && get_largest_free_partition_size(mem) == 10000);
+    free_memory(mem);
+
+    struct partition* (*list_fits[4])(struct memory*, uint64_t) = {first_fit, best_fit, roving_next_fit, worst_fit};
+    struct partition* (*table_fits[4])(struct memory*, uint64_t) = {table_first_fit, table_best_fit, table_next_fit, table_worst_fit};
+    bool is_same_placement = true;
+    for (int fit = 0; fit < 4; fit++) {
+        struct block_layout layout;
+        init_block_layout(&layout, 1, fit + 1);  // Small remainders stay in the block
+        struct memory* list = get_new_memory_with_layout(20000, 0, &layout);
+        struct memory* table = get_new_table_memory_with_layout(20000, 0, &layout);
+        struct partition* list_parts[300] = {NULL};
+        struct partition* table_parts[300] = {NULL};
+        unsigned int seed = 303;
+        for (int i = 0; i < 10000; i++) {
+            int slot = rand_r(&seed) % 300;
+            if (list_parts[slot] != NULL) {
+                deallocate_partition(list_parts[slot]);
+                deallocate_partition(table_parts[slot]);
+            }
+            uint64_t size = 1 + rand_r(&seed) % 100;
+            list_parts[slot] = list_fits[fit](list, size);
+            table_parts[slot] = table_fits[fit](table, size);
+            is_same_placement &= (list_parts[slot] == NULL) == (table_parts[slot] == NULL) && (list_parts[slot] == NULL || (list_parts[slot]->address == table_parts[slot]->address && list_parts[slot]->size == table_parts[slot]->size));
+            is_same_placement &= list->free_partitions == table->free_partitions && list->free_size == table->free_size && get_largest_free_partition_size(list) == get_largest_free_partition_size(table);
+        }
+        free_memory(list);
+        free_memory(table);
+    }
+    test_log("Table fits place like the partition list", is_same_placement);
+}
+
+void* churn_arena(void* arg) {
+    struct arena* arena = (struct arena*)arg;
+    unsigned char* ptrs[16] = {NULL};
+    size_t sizes[16] = {0};
+    unsigned int seed = (unsigned int)(uintptr_t)&ptrs;
+    bool is_intact = true;
+    for (int i = 0; i < 5000; i++) {
+        int slot = rand_r(&seed) % 16;
+        if (ptrs[slot] != NULL) {
+            for (size_t j = 0; j < sizes[slot]; j++)
+                is_intact &= ptrs[slot][j] == (unsigned char)slot;
+            arena_free(arena, ptrs[slot]);
+        }
+        sizes[slot] = rand_r(&seed) % 2000;
+        ptrs[slot] = (unsigned char*)(rand_r(&seed) % 4 == 0 ? arena_alloc_aligned(arena, 256, sizes[slot]) : arena_alloc(arena, sizes[slot]));
+        if (ptrs[slot] != NULL)
+            memset(ptrs[slot], slot, sizes[slot]);
+    }
+    for (int slot = 0; slot < 16; slot++)
+        arena_free(arena, ptrs[slot]);
+    return is_intact ? arena : NULL;
+}
+
+void test_arena() {
+    struct memory* mem = get_new_empty_memory(1000, 0);
+    struct partition* first = first_fit(mem, 100);
+    struct partition* second = first_fit(mem, 100);
+    test_log("Resized partition shrinks in place", resize_partition(mem, first, 40) == first && first->size == 40 && first->next->is_free && first->next->size == 60 && mem->requested_size == 140 && is_free_list_index_consistent(mem));
+    test_log("Resized partition cannot grow past an allocated successor", resize_partition(mem, first, 101) == NULL && first->size == 40 && first->requested_size == 40);
+    test_log("Resized partition grows into its free successor", resize_partition(mem, second, 900) == second && second->size == 900 && second->next == NULL && mem->used_size == 940 && is_free_list_index_consistent(mem));
+    free_memory(mem);
+
+    struct arena arena;
+    test_log("Arena rejects the buddy system", !init_arena(&arena, 1 << 20, BUDDY));
+    test_log("Arena maps whole pages", init_arena(&arena, (1 << 20) + 1, BEST_FIT) && arena.size % arena.page_size == 0 && arena.size > (1 << 20));
+    char* a = (char*)arena_alloc(&arena, 100);
+    char* b = (char*)arena_alloc(&arena, 200);
+    char* c = (char*)arena_alloc(&arena, 300);
+    struct partition* part = get_arena_partition(a);
+    test_log("Arena headers sit inline in front of the payload", (char*)part == a - ARENA_HEADER_SIZE && part->mem == &arena.mem && part->address == 0 && (char*)part->next == b - ARENA_HEADER_SIZE && is_in_arena(&arena, c));
+    test_log("Arena payloads are aligned", (uintptr_t)a % ARENA_MIN_ALIGNMENT == 0 && (uintptr_t)b % ARENA_MIN_ALIGNMENT == 0 && get_arena_usable_size(a) >= 100);
+    arena_free(&arena, a);
+    test_log("Arena memory is never compacted", compact_memory(&arena.mem) == 0 && get_arena_partition(b)->address == (uint64_t)(b - ARENA_HEADER_SIZE - arena.base));
+    a = (char*)arena_alloc(&arena, 100);
+
+    arena_free(&arena, b);
+    memset(a, 7, 100);
+    char* grown = (char*)arena_realloc(&arena, a, 250);
+    test_log("Arena realloc grows into the freed neighbour", grown == a && get_arena_usable_size(a) >= 250 && a[99] == 7);
+    char* moved = (char*)arena_realloc(&arena, a, 5000);
+    test_log("Arena realloc moves blocks that cannot grow", moved != a && moved[0] == 7 && moved[99] == 7 && get_arena_usable_size(moved) >= 5000);
+
+    char* aligned = (char*)arena_alloc_aligned(&arena, 4096, 10);
+    test_log("Over-aligned payloads point back to their block", (uintptr_t)aligned % 4096 == 0 && get_arena_partition(aligned)->mem == &arena.mem && get_arena_usable_size(aligned) >= 10);
+    arena_free(&arena, aligned);
+    arena_free(&arena, moved);
+    arena_free(&arena, c);
+    test_log("Arena coalesces every freed block", arena.mem.used_size == 0 && arena.mem.free_partitions == 1 && is_free_list_index_consistent(&arena.mem));
+    test_log("Arena fails allocations it cannot hold", arena_alloc(&arena, arena.size) == NULL && arena_alloc_aligned(&arena, 2 * arena.size, 1) == NULL);
+    free_arena(&arena);
+
+    init_arena(&arena, 16 << 20, TLSF);
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+        pthread_create(&threads[i], NULL, churn_arena, &arena);
+    bool is_intact = true;
+    for (int i = 0; i < 4; i++) {
+        void* result;
+        pthread_join(threads[i], &result);
+        is_intact &= result != NULL;
+    }
+    test_log("Arena is shared safely between threads", is_intact && arena.mem.used_size == 0 && arena.mem.free_partitions == 1 && is_free_list_index_consistent(&arena.mem));
+    free_arena(&arena);
+}
+
+void* churn_shards(void* arg) {
+    struct sharded_memory* sharded = (struct sharded_memory*)arg;
+    struct timeval t;
+    struct partition* parts[8] = {NULL};
+    unsigned int seed = 1;
+    for (int i = 0; i < 2000; i++) {
+        int slot = rand_r(&seed) % 8;
+        if (parts[slot] != NULL)
+            deallocate_from_shards(sharded, parts[slot]);
+        struct process* proc = get_new_process(1 + rand_r(&seed) % 10, 0, t);
+        parts[slot] = allocate_from_shards(sharded, proc);
+        free_process(proc);
+    }
+    for (int slot = 0; slot < 8; slot++) {
+        if (parts[slot] != NULL)
+            deallocate_from_shards(sharded, parts[slot]);
+    }
+    return NULL;
+}
+
+void test_sharded_memory() {
+    struct timeval t;
+    struct block_layout layout;
+    init_block_layout(&layout, 1, 1);
+    struct sharded_memory* sharded = get_new_sharded_memory(110, 10, 3, FIRST_FIT, &layout, SHARD_ROUND_ROBIN, 30);
+    test_log("Memory is split evenly into shards", sharded->shards[0].mem->p == 34 && sharded->shards[1].base_address == 34 && sharded->shards[2].base_address == 67 && sharded->shards[2].mem->p == 33);
+
+    struct process* proc = get_new_process(30, 1, t);
+    struct partition* first = allocate_from_shards(sharded, proc);
+    proc->s = 10;
+    struct partition* second = allocate_from_shards(sharded, proc);
+    struct partition* third = allocate_from_shards(sharded, proc);
+    test_log("Round robin shard selection", first->mem == sharded->shards[0].mem && second->mem == sharded->shards[1].mem && third->mem == sharded->shards[2].mem && get_shard_of_partition(sharded, second) == &sharded->shards[1]);
+
+    proc->s = 20;
+    struct partition* spilled = allocate_from_shards(sharded, proc);  // Round robin is back at shard 0, which has 4MB left
+    proc->s = 30;
+    test_log("Allocation spills over to the next shards", spilled != NULL && spilled->mem == sharded->shards[1].mem && allocate_from_shards(sharded, proc) == NULL);
+
+    sharded->policy = SHARD_LEAST_LOADED;
+    test_log("Least loaded shard selection", select_shard(sharded, 5) == 2);
+    sharded->policy = SHARD_SIZE_AFFINITY;
+    test_log("Size affinity shard selection", select_shard(sharded, 5) == 0 && select_shard(sharded, 15) == 1 && select_shard(sharded, 30) == 2);
+    test_log("Sharded memory utilization", get_sharded_memory_utilization(sharded) > 72.7f && get_sharded_memory_utilization(sharded) < 72.8f);
+
+    deallocate_from_shards(sharded, first);
+    deallocate_from_shards(sharded, second);
+    deallocate_from_shards(sharded, third);
+    deallocate_from_shards(sharded, spilled);
+    free_process(proc);
+
+    sharded->policy = SHARD_ROUND_ROBIN;
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+        pthread_create(&threads[i], NULL, churn_shards, sharded);
+    for (int i = 0; i < 4; i++)
+        pthread_join(threads[i], NULL);
+    bool consistent = true;
+    for (int i = 0; i < 3; i++)
+        consistent = consistent && sharded->shards[i].mem->used_size == 0 && sharded->shards[i].used_size == 0 && sharded->shards[i].mem->free_partitions == 1 && are_memory_counters_consistent(sharded->shards[i].mem);
+    test_log("Shards stay consistent under concurrent allocators", consistent);
+    free_sharded_memory(sharded);
 }
 
 void test_queue() {
     struct timeval t;
     int MAX_SIZE = 2;
     struct process_queue* queue = get_new_empty_queue(MAX_SIZE);
-    test_log("get_new_empty_queue()", queue->size == 0 && queue->max_size == MAX_SIZE);
+    test_log("get_new_empty_queue()", get_queue_size(queue) == 0 && queue->max_size == MAX_SIZE);
 
     enqueue(queue, get_new_process(10, 20, t));
     struct process* front = peek_queue(queue);
-    test_log("(1/2) enqueue()", queue->size == 1 && front->s == 10 && front->d == 20);
+    test_log("(1/2) enqueue()", get_queue_size(queue) == 1 && front->s == 10 && front->d == 20);
 
     enqueue(queue, get_new_process(30, 40, t));
     front = peek_queue(queue);
-    struct process* back = queue->head->proc;
-    test_log("(2/2) enqueue()", queue->size == 2 && front->s == 10 && front->d == 20 && back->s == 30 && back->d == 40);
+    struct process* back = queue->slots[(queue->tail - 1) & queue->mask];
+    test_log("(2/2) enqueue()", get_queue_size(queue) == 2 && front->s == 10 && front->d == 20 && back->s == 30 && back->d == 40);
 
     test_log("Queue max size check", enqueue(queue, get_new_process(50, 60, t)) == false);
 
     front = dequeue(queue);
-    test_log("(1/2) dequeue()", queue->size == 1 && front->s == 10 && front->d == 20);
+    test_log("(1/2) dequeue()", get_queue_size(queue) == 1 && front->s == 10 && front->d == 20);
     free_process(front);
 
     free_process(dequeue(queue));
-    test_log("(2/2) dequeue()", queue->size == 0 && dequeue(queue) == NULL);
+    test_log("(2/2) dequeue()", get_queue_size(queue) == 0 && dequeue(queue) == NULL);
+
+    free_queue(queue);
+}
+
+#define SPSC_TEST_ITEMS (100000)
+
+void* produce_queue_items(void* args) {
+    struct process_queue* queue = (struct process_queue*)args;
+    for (long i = 1; i <= SPSC_TEST_ITEMS; i++) {
+        while (!enqueue(queue, (struct process*)i))
+            sched_yield();
+    }
+    return NULL;
+}
+
+void test_queue_between_threads() {
+    struct process_queue* queue = get_new_empty_queue(7);
+    pthread_t producer;
+    pthread_create(&producer, NULL, produce_queue_items, queue);
+    bool ordered = true;
+    for (long i = 1; i <= SPSC_TEST_ITEMS; i++) {
+        while (is_queue_empty(queue))
+            sched_yield();
+        ordered = ordered && peek_queue(queue) == (struct process*)i && dequeue(queue) == (struct process*)i;
+    }
+    pthread_join(producer, NULL);
+    test_log("Queue hands off between producer and consumer threads in order", ordered && is_queue_empty(queue));
+    free_queue(queue);
+}
+
+void test_pool() {
+    struct object_pool* pool = get_new_object_pool(sizeof(struct partition), 2, false);
+    void* a = pool_alloc(pool);
+    void* b = pool_alloc(pool);
+    void* c = pool_alloc(pool);
+    test_log("Pool grows by chunks", a != NULL && b != NULL && c != NULL && a != b && b != c && a != c && pool->chunks != NULL && pool->chunks->next != NULL);
+
+    pool_free(pool, b);
+    test_log("Pool reuses freed objects", pool_alloc(pool) == b);
+    free_object_pool(pool);
+
+    struct process_queue* queue = get_new_empty_queue(2);
+    struct timeval t;
+    struct process* proc = get_new_queued_process(queue, 10, 20, t);
+    test_log("Queued process comes from the queue pool", proc->pool == queue->process_pool && proc->s == 10 && proc->d == 20);
+    free_process(proc);
+    enqueue(queue, get_new_queued_process(queue, 30, 40, t));
+    free_queue(queue);
+}
+
+void test_heap() {
+    struct min_heap* heap = get_new_min_heap(1);
+    int items[] = {0, 1, 2, 3, 4};
+    heap_push(heap, 30, &items[0]);
+    heap_push(heap, 10, &items[1]);
+    heap_push(heap, 20, &items[2]);
+    heap_push(heap, 10, &items[3]);
+    heap_push(heap, 5, &items[4]);
+    long key;
+    bool ordered = heap_pop(heap, &key) == &items[4] && key == 5;
+    ordered = ordered && heap_pop(heap, &key) == &items[1] && key == 10;
+    ordered = ordered && heap_pop(heap, &key) == &items[3] && key == 10;
+    ordered = ordered && heap_pop(heap, &key) == &items[2] && key == 20;
+    ordered = ordered && heap_pop(heap, &key) == &items[0] && key == 30;
+    test_log("Min heap pops by key, ties in insertion order", ordered && is_heap_empty(heap) && heap_pop(heap, NULL) == NULL);
+    free_min_heap(heap);
+}
+
+void* record_thousand_values(void* arg) {
+    for (long i = 1; i <= 1000; i++)
+        record_histogram_value((struct histogram*)arg, i);
+    return NULL;
+}
+
+void test_histogram() {
+    struct histogram* histogram = (struct histogram*)malloc(sizeof(struct histogram));
+    init_histogram(histogram);
+    test_log("Empty histogram", get_histogram_percentile(histogram, 99) == 0 && get_histogram_count(histogram) == 0);
+
+    bool is_precise = true;
+    for (long value = 1; value < (1L << 40); value = value * 3 + 1) {
+        long bucket_max = get_histogram_bucket_max_value(get_histogram_bucket(value));
+        is_precise = is_precise && bucket_max >= value && bucket_max - value <= value / 16;
+    }
+    test_log("Histogram buckets are within 1/16 of the value", is_precise && get_histogram_bucket(31) == 31 && get_histogram_bucket_max_value(NUM_HISTOGRAM_BUCKETS - 1) == (~0UL >> 1));
+
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+        pthread_create(&threads[i], NULL, record_thousand_values, histogram);
+    for (int i = 0; i < 4; i++)
+        pthread_join(threads[i], NULL);
+    long p50 = get_histogram_percentile(histogram, 50);
+    long p99 = get_histogram_percentile(histogram, 99);
+    test_log("Histogram records from several threads", get_histogram_count(histogram) == 4000 && get_histogram_max(histogram) == 1000 && get_histogram_mean(histogram) == 500.5);
+    test_log("Histogram percentiles", p50 >= 500 && p50 <= 500 + 500 / 16 && p99 >= 990 && get_histogram_percentile(histogram, 100) == 1000);
+
+    struct histogram* other = (struct histogram*)malloc(sizeof(struct histogram));
+    init_histogram(other);
+    for (int i = 0; i < 4000; i++)
+        record_histogram_value(other, 100000);
+    merge_histogram(histogram, other);
+    test_log("Merged histogram", get_histogram_count(histogram) == 8000 && get_histogram_percentile(histogram, 25) <= 1000 && get_histogram_percentile(histogram, 75) >= 100000 - 100000 / 16 && get_histogram_max(histogram) == 100000);
+    free(other);
+    free(histogram);
+}
+
+void test_logger() {
+    FILE* stream = tmpfile();
+    set_log_stream(stream);
+    unmute_logs();
+    set_log_level(LOG_LEVEL_INFO);
+
+    log_debug("filtered");
+    log_info("sync %d", 1);
+    fflush(stream);
+    char line[LOG_RECORD_SIZE];
+    rewind(stream);
+    bool formatted = fgets(line, sizeof(line), stream) != NULL && strncmp(line, "INFO  ", 6) == 0 && strstr(line, ": sync 1\n") != NULL;
+    test_log("Log line is prefixed with level and time", formatted && fgets(line, sizeof(line), stream) == NULL);
+
+    int total_lines = 1000;
+    enable_async_logging(8);
+    for (int i = 0; i < total_lines; i++)
+        log_warning("async %d", i);
+    flush_logs();
+    long dropped = get_dropped_log_count();
+    disable_async_logging();
+
+    rewind(stream);
+    int written_lines = 0;
+    while (fgets(line, sizeof(line), stream) != NULL) written_lines++;
+    test_log("Async log writes or counts every line", written_lines - 1 + dropped == total_lines && written_lines > 1);
+
+    fclose(stream);
+    set_log_stream(stdout);
+    mute_logs();
+}
+
+void test_backfill() {
+    struct timeval t;
+    struct memory* mem = get_new_empty_memory(100, 0);
+    struct partition* first = first_fit(mem, 30);
+    struct partition* second = first_fit(mem, 50);
+    // Free: 20 at 80
+
+    struct process_queue* queue = get_new_empty_queue(8);
+    int sizes[] = {40, 15, 20, 10};
+    for (int i = 0; i < 4; i++)
+        enqueue(queue, get_new_process(sizes[i], 1, t));
+
+    struct backfill_scheduler* best = get_new_backfill_scheduler(BACKFILL_BEST, DEFAULT_BACKFILL_LIMIT);
+    test_log("Best fit backfill picks the largest process that fits", find_backfill_process(best, queue, mem) == 2);
+    free_backfill_scheduler(best);
+
+    struct backfill_scheduler* scheduler = get_new_backfill_scheduler(BACKFILL_FIRST, 2);
+    test_log("First fit backfill picks the earliest process that fits", find_backfill_process(scheduler, queue, mem) == 1);
+    struct process* proc = take_backfill_process(scheduler, queue, 1);
+    test_log("dequeue_at() keeps the order of the rest", proc->s == 15 && get_queue_size(queue) == 3 && peek_queue_at(queue, 0)->s == 40 && peek_queue_at(queue, 1)->s == 20 && peek_queue_at(queue, 2)->s == 10 && peek_queue_at(queue, 3) == NULL);
+    free_process(proc);
+
+    free_process(take_backfill_process(scheduler, queue, find_backfill_process(scheduler, queue, mem)));
+    test_log("Head is reserved after the backfill limit", scheduler->head_bypasses == 2 && find_backfill_process(scheduler, queue, mem) == -1);
+
+    deallocate_partition(second);
+    proc = take_backfill_process(scheduler, queue, find_backfill_process(scheduler, queue, mem));
+    test_log("Reserved head starts once it fits", proc->s == 40 && scheduler->head_bypasses == 0);
+    free_process(proc);
+    free_process(take_backfill_process(scheduler, queue, 0));
+    test_log("Size class index follows the queue", scheduler->queued_size_classes == 0 && scheduler->indexed == 4 && scheduler->dequeued == 4);
+
+    first_fit(mem, 50);
+    enqueue(queue, get_new_process(60, 1, t));
+    enqueue(queue, get_new_process(40, 1, t));
+    test_log("Backfill skips the scan when no queued process fits", find_backfill_process(scheduler, queue, mem) == -1 && get_largest_free_partition_size(mem) == 20);
+    free_process(dequeue(queue));
+    free_process(dequeue(queue));
 
+    free_backfill_scheduler(scheduler);
     free_queue(queue);
+    deallocate_partition(first);
+    free_memory(mem);
+}
+
+bool is_scheduled_in_order(enum scheduling_policy policy, int* expected_sizes) {
+    struct timeval t;
+    int sizes[] = {30, 10, 20, 40, 5};
+    int durations[] = {8, 20, 2, 3, 9};
+    struct process_queue* queue = get_new_empty_queue(5);
+    struct process_scheduler* scheduler = get_new_process_scheduler(queue, policy);
+    for (int i = 0; i < 4; i++)
+        enqueue(queue, get_new_process(sizes[i], durations[i], t));
+    bool in_order = peek_scheduled_process(scheduler) != NULL;
+    enqueue(queue, get_new_process(sizes[4], durations[4], t));  // Arrives once the others are admitted
+    in_order = in_order && is_queue_full(queue);
+    for (int i = 0; i < 5; i++) {
+        struct process* proc = dequeue_scheduled_process(scheduler);
+        in_order = in_order && proc != NULL && proc->s == expected_sizes[i] && get_queue_size(queue) == 4 - i;
+        free_process(proc);
+    }
+    in_order = in_order && !has_scheduled_process(scheduler) && dequeue_scheduled_process(scheduler) == NULL;
+    free_process_scheduler(scheduler);
+    free_queue(queue);
+    return in_order;
+}
+
+void test_scheduling() {
+    test_log("FIFO scheduling", is_scheduled_in_order(SCHEDULE_FIFO, (int[]){30, 10, 20, 40, 5}));
+    test_log("Shortest job first scheduling", is_scheduled_in_order(SCHEDULE_SHORTEST_JOB_FIRST, (int[]){20, 40, 30, 5, 10}));
+    test_log("Smallest first scheduling", is_scheduled_in_order(SCHEDULE_SMALLEST_FIRST, (int[]){5, 10, 20, 30, 40}));
+    test_log("Priority class scheduling", is_scheduled_in_order(SCHEDULE_PRIORITY_CLASSES, (int[]){20, 40, 30, 5, 10}));
+
+    enum scheduling_policy policy;
+    test_log("Scheduling policy parsing", parse_scheduling_policy("sjf", &policy) && policy == SCHEDULE_SHORTEST_JOB_FIRST && parse_scheduling_policy("priority", &policy) && policy == SCHEDULE_PRIORITY_CLASSES && !parse_scheduling_policy("lifo", &policy));
+}
+
+void* draw_from_thread_rng(void* args) {
+    *(uint64_t*)args = next_rng(get_thread_rng());
+    return NULL;
+}
+
+void test_rng() {
+    struct rng a, b, c;
+    seed_rng(&a, 42);
+    seed_rng(&b, 42);
+    seed_rng(&c, 43);
+    bool same = true, different = false;
+    for (int i = 0; i < 100; i++) {
+        uint64_t x = next_rng(&a);
+        same = same && x == next_rng(&b);
+        different = different || x != next_rng(&c);
+    }
+    test_log("Generators with the same seed agree", same && different);
+
+    int counts[6] = {0};
+    bool in_range = true;
+    for (int i = 0; i < 60000; i++) {
+        int value = randint_r(&a, 1, 6);
+        in_range = in_range && value >= 1 && value <= 6;
+        if (in_range) counts[value - 1]++;
+    }
+    bool uniform = true;
+    for (int i = 0; i < 6; i++)
+        uniform = uniform && counts[i] > 9500 && counts[i] < 10500;
+    test_log("Bounded integers are in range and uniform", in_range && uniform && randint_r(&a, 5, 4) == 0 && randint_r(&a, 7, 7) == 7);
+
+    double uniform_sum = 0, exponential_sum = 0;
+    int below_median = 0;
+    bool unit_interval = true;
+    for (int i = 0; i < 100000; i++) {
+        double u = get_rng_uniform(&a);
+        unit_interval = unit_interval && u >= 0 && u < 1;
+        uniform_sum += u;
+        exponential_sum += get_rng_exponential(&a, 4);
+        below_median += get_rng_lognormal(&a, 1, 0.5) < exp(1);
+    }
+    test_log("Uniform sampler", unit_interval && fabs(uniform_sum / 100000 - 0.5) < 0.01);
+    test_log("Exponential sampler", fabs(exponential_sum / 100000 - 0.25) < 0.005);
+    test_log("Log-normal sampler", abs(below_median - 50000) < 1000);
+
+    uint64_t first[2], second[2];
+    pthread_t threads[2];
+    for (int round = 0; round < 2; round++) {
+        uint64_t* draws = round == 0 ? first : second;
+        seed_thread_rngs(7);
+        for (int i = 0; i < 2; i++) {  // One at a time, the order threads first draw in picks their streams
+            pthread_create(&threads[i], NULL, draw_from_thread_rng, &draws[i]);
+            pthread_join(threads[i], NULL);
+        }
+    }
+    test_log("Thread generators are distinct and seeded", first[0] != first[1] && first[0] == second[0] && first[1] == second[1]);
+}
+
+/*
+Arrivals per second over a 1000s window and the variance of the counts of its 1s slots
+*/
+double get_arrival_rate_and_variance(struct arrival_model* model, double r, double* variance, double* mean_batch_size) {
+    struct rng rng;
+    seed_rng(&rng, 3);
+    struct arrival_generator arrivals;
+    init_arrival_generator(&arrivals, model, r);
+    static long counts[1000];
+    memset(counts, 0, sizeof(counts));
+    long total = 0, batches = 0;
+    double time_in_millis;
+    int batch_size;
+    while ((batch_size = next_arrival_batch(&arrivals, &rng, &time_in_millis)) > 0 && time_in_millis < 1000000) {
+        counts[(long)time_in_millis / 1000] += batch_size;
+        total += batch_size;
+        batches++;
+    }
+    double mean = total / 1000.0;
+    *variance = 0;
+    for (int i = 0; i < 1000; i++)
+        *variance += (counts[i] - mean) * (counts[i] - mean) / 1000;
+    *mean_batch_size = (double)total / batches;
+    return mean;
+}
+
+void test_arrivals() {
+    double variance, mean_batch_size;
+    double rate = get_arrival_rate_and_variance(NULL, 50, &variance, &mean_batch_size);
+    test_log("Poisson arrivals", fabs(rate - 50) < 1 && fabs(variance / rate - 1) < 0.15 && mean_batch_size == 1);
+
+    struct arrival_model model;
+    test_log("Arrival model parsing", parse_arrival_model("bursty:4", &model) && model.distribution == ARRIVALS_BURSTY && model.mean_batch_size == 4 && parse_arrival_model("mmpp", &model) && model.peak_factor == DEFAULT_MMPP_PEAK_FACTOR && !parse_arrival_model("mmpp:3", &model) && !parse_arrival_model("uniform", &model));
+
+    init_arrival_model(&model, ARRIVALS_BURSTY, 4, DEFAULT_MMPP_PEAK_FACTOR, DEFAULT_MMPP_DWELL_IN_MILLIS);
+    rate = get_arrival_rate_and_variance(&model, 50, &variance, &mean_batch_size);
+    test_log("Bursty arrivals come in batches at the same mean rate", fabs(rate - 50) < 2 && fabs(mean_batch_size - 4) < 0.2 && variance > 3 * rate);
+
+    init_arrival_model(&model, ARRIVALS_MMPP, 1.8, DEFAULT_MMPP_PEAK_FACTOR, 5000);
+    rate = get_arrival_rate_and_variance(&model, 50, &variance, &mean_batch_size);
+    test_log("Markov-modulated arrivals alternate rates at the same mean rate", fabs(rate - 50) < 5 && variance > 10 * rate && mean_batch_size == 1);
+
+    rate = get_arrival_rate_and_variance(NULL, 20000, &variance, &mean_batch_size);
+    test_log("Arrival rates beyond one per millisecond", fabs(rate / 20000 - 1) < 0.01);
+
+    struct arrival_generator none;
+    double time_in_millis;
+    init_arrival_generator(&none, NULL, 0);
+    test_log("No arrivals at rate 0", next_arrival_batch(&none, NULL, &time_in_millis) == 0);
 }
 
 void test_ds() {
     test_process_and_memory();
+    test_roving_next_fit();
+    test_worst_fit_and_tlsf();
+    test_buddy();
+    test_compaction();
+    test_alignment();
+    test_arena();
+    test_bitmap();
+    test_table();
+    test_sharded_memory();
     test_queue();
+    test_queue_between_threads();
+    test_backfill();
+    test_scheduling();
+    test_pool();
+    test_heap();
+    test_histogram();
+    test_rng();
+    test_arrivals();
+}
+
+struct counting_task {
+    struct thread_pool* pool;
+    _Atomic int* count;
+};
+
+void count_task(void* arg) {
+    struct counting_task* task = (struct counting_task*)arg;
+    atomic_fetch_add(task->count, 1);
+}
+
+void spawn_counting_tasks(void* arg) {
+    struct counting_task* task = (struct counting_task*)arg;
+    for (int i = 0; i < 10; i++)
+        submit_task(task->pool, count_task, task);
+}
+
+void test_trace() {
+    char path[] = "/tmp/cs303_trace_XXXXXX";
+    close(mkstemp(path));
+    struct trace_writer* writer = open_trace_writer(path);
+    write_trace_record(writer, 10, 20, 5);
+    write_trace_record(writer, 30, 40, 15);
+    close_trace_writer(writer);
+    write_trace_record(writer, 50, 60, 25);
+    test_log("Trace writer ignores records after close", writer->records == 2);
+    free_trace_writer(writer);
+
+    struct trace_reader* reader = open_trace_reader(path);
+    const struct trace_record* peeked = reader != NULL ? peek_trace_record(reader) : NULL;
+    const struct trace_record* first = reader != NULL ? next_trace_record(reader) : NULL;
+    const struct trace_record* second = reader != NULL ? next_trace_record(reader) : NULL;
+    test_log("Trace records are replayed in order", reader != NULL && reader->num_records == 2 && peeked == first && first->arrival_offset_in_millis == 10 && first->size == 20 && second->duration == 15 && next_trace_record(reader) == NULL);
+    close_trace_reader(reader);
+
+    struct stats* recorded = get_empty_stats();
+    struct stats* replayed = get_empty_stats();
+    writer = open_trace_writer(path);
+    run_event_driven(1000, 200, 10, 10, 5, NULL, FIRST_FIT, NULL, 10, 5, 7, NULL, writer, SCHEDULE_FIFO, NULL, NULL, recorded);
+    close_trace_writer(writer);
+    reader = open_trace_reader(path);
+    run_event_driven(1000, 200, 10, 10, 5, NULL, FIRST_FIT, NULL, 10, 5, 8, reader, NULL, SCHEDULE_FIFO, NULL, NULL, replayed);
+    test_log("Replayed trace reproduces the recorded run", reader->num_records == writer->records && reader->next == reader->num_records && replayed->turnaround_time_den == recorded->turnaround_time_den && replayed->turnaround_time_num == recorded->turnaround_time_num);
+    close_trace_reader(reader);
+    free_trace_writer(writer);
+    free(recorded);
+    free(replayed);
+
+    writer = open_trace_writer(path);
+    for (int i = 0; i < 5; i++)
+        write_trace_record(writer, 20 * i, 1000, 5);
+    close_trace_writer(writer);
+    free_trace_writer(writer);
+    struct process_queue* queue = get_new_empty_queue(2);
+    struct stats* dropped = get_empty_stats();
+    pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t process_queued = PTHREAD_COND_INITIALIZER;
+    atomic_int waiting_allocators = 0;
+    char record_path[] = "/tmp/cs303_trace_XXXXXX";
+    close(mkstemp(record_path));
+    writer = open_trace_writer(record_path);
+    reader = open_trace_reader(path);
+    struct process_creator_args* creator_args = get_process_creator_args(queue, 0, NULL, 1, 1, reader, writer, &queue_mutex, &process_queued, &waiting_allocators, dropped);
+    struct timeval before = get_curr_time();
+    process_creator(creator_args);
+    struct process* early = dequeue(queue);
+    struct process* late = dequeue(queue);
+    test_log("Replayed arrivals past a full queue are counted as dropped", early != NULL && late != NULL && atomic_load(&dropped->dropped_arrivals) == 3);
+    test_log("Queued processes are stamped with their scheduled arrival time", get_time_diff_in_millis(early->arrival_time, late->arrival_time) == 20 && get_time_diff_in_millis(before, early->arrival_time) <= 1);
+    test_log("Dropped arrivals are recorded too", writer->records == 5);
+    close_trace_reader(reader);
+    close_trace_writer(writer);
+    free_trace_writer(writer);
+    unlink(record_path);
+    free(creator_args);
+    free_queue(queue);
+    free(dropped);
+
+    writer = open_trace_writer(path);
+    write_trace_record(writer, 0, 700 * BYTES_PER_MB, 100);
+    write_trace_record(writer, 10, 500 * BYTES_PER_MB, 100);
+    write_trace_record(writer, 20, 50 * BYTES_PER_MB, 1);
+    close_trace_writer(writer);
+    free_trace_writer(writer);
+    struct stats* backfilled = get_empty_stats();
+    struct backfill_scheduler* backfill = get_new_backfill_scheduler(BACKFILL_FIRST, DEFAULT_BACKFILL_LIMIT);
+    reader = open_trace_reader(path);
+    run_event_driven(1000, 200, 10, 10, 5, NULL, FIRST_FIT, NULL, 10, 10, 1, reader, NULL, SCHEDULE_FIFO, backfill, NULL, backfilled);
+    test_log("Backfill places an arrival behind a blocked head right away", backfilled->turnaround_time_den == 3 && backfilled->turnaround_time_num == 100000 - 10);
+    close_trace_reader(reader);
+    free_backfill_scheduler(backfill);
+    free(backfilled);
+
+    FILE* file = fopen(path, "wb");
+    fputs("not a trace at all", file);
+    fclose(file);
+    test_log("Trace reader rejects other files", open_trace_reader(path) == NULL);
+
+    struct trace_header old_header = {TRACE_MAGIC, 1, 16};
+    file = fopen(path, "wb");
+    fwrite(&old_header, sizeof(old_header), 1, file);
+    fclose(file);
+    test_log("Trace reader rejects traces of sizes in MBs", open_trace_reader(path) == NULL);
+    unlink(path);
+}
+
+void test_thread_pool() {
+    _Atomic int count = 0;
+    struct thread_pool* pool = get_new_thread_pool(4);
+    struct counting_task task = {pool, &count};
+    for (int i = 0; i < 100; i++)
+        submit_task(pool, count_task, &task);
+    wait_for_tasks(pool);
+    test_log("Thread pool runs every task", atomic_load(&count) == 100);
+
+    for (int i = 0; i < 10; i++)
+        submit_task(pool, spawn_counting_tasks, &task);
+    free_thread_pool(pool);
+    test_log("Thread pool runs tasks submitted by workers", atomic_load(&count) == 200);
+}
+
+void test_sweep() {
+    struct compaction_policy compaction = {COMPACTION_DISABLED, 0, 0, DEFAULT_COMPACTION_BANDWIDTH, 0};
+    struct sweep* serial = get_new_sweep();
+    struct sweep* parallel = get_new_sweep();
+    test_log("Sweep grid expands every combination", add_sweep_grid(serial, "1000 200 10 10 10 1 10 0,2-3 1-3\n", &compaction) && serial->size == 9 && serial->runs[0].seed == 1 && serial->runs[3].algo == NEXT_FIT && serial->runs[8].algo == BUDDY);
+    test_log("Sweep grid rejects invalid configurations", !add_sweep_grid(serial, "1000 2000 10 10 10 1 10 0 1", &compaction) && !add_sweep_grid(serial, "1000 200 10 10 10 1 10 0", &compaction) && serial->size == 9);
+
+    add_sweep_grid(parallel, "1000 200 10 10 10 1 10 0,2-3 1-3", &compaction);
+    run_sweep(serial, 1);
+    run_sweep(parallel, 4);
+    bool identical = true;
+    for (int i = 0; i < serial->size; i++)
+        identical = identical && serial->runs[i].stat->turnaround_time_num == parallel->runs[i].stat->turnaround_time_num && serial->runs[i].stat->memory_utilization_num == parallel->runs[i].stat->memory_utilization_num;
+    test_log("Parallel sweep matches a serial one", identical && serial->runs[0].stat->turnaround_time_den > 0);
+    free_sweep(serial);
+    free_sweep(parallel);
+
+    struct sweep* scheduled = get_new_sweep();
+    test_log("Sweep grid takes an optional scheduling policy", add_sweep_grid(scheduled, "1000 200 10 10 10 1 10 1 1 0-3", &compaction) && scheduled->size == 4 && scheduled->runs[0].scheduling == SCHEDULE_FIFO && scheduled->runs[3].scheduling == SCHEDULE_PRIORITY_CLASSES && !add_sweep_grid(scheduled, "1000 200 10 10 10 1 10 1 1 4", &compaction));
+    run_sweep(scheduled, 2);
+    bool all_allocated = true;
+    for (int i = 0; i < scheduled->size; i++)
+        all_allocated = all_allocated && scheduled->runs[i].stat->turnaround_time_den > 0;
+    test_log("Event-driven simulation under every scheduling policy", all_allocated);
+    free_sweep(scheduled);
+}
+
+void test_completion_service() {
+    pthread_mutex_t mem_mutex;
+    pthread_cond_t mem_available;
+    pthread_mutex_init(&mem_mutex, NULL);
+    pthread_cond_init(&mem_available, NULL);
+    struct completion_service* service = start_completion_service(&mem_mutex, &mem_available);
+
+    struct memory* mem = get_new_empty_memory(100, 10);
+    struct timeval t;
+    pthread_mutex_lock(&mem_mutex);
+    struct partition* first = first_fit(mem, 20);
+    struct partition* second = first_fit(mem, 30);
+    schedule_completion(service, get_new_process(30, 1, t), second);
+    schedule_completion(service, get_new_process(20, 0, t), first);
+    pthread_mutex_unlock(&mem_mutex);
+
+    bool first_freed = false;
+    for (int i = 0; i < 100 && !first_freed; i++) {
+        usleep(10000);
+        pthread_mutex_lock(&mem_mutex);
+        first_freed = mem->head->is_free && mem->head->size == 20;
+        pthread_mutex_unlock(&mem_mutex);
+    }
+    test_log("Completion service frees expired processes first", first_freed);
+
+    bool all_freed = false;
+    for (int i = 0; i < 200 && !all_freed; i++) {
+        usleep(10000);
+        pthread_mutex_lock(&mem_mutex);
+        all_freed = mem->head->is_free && mem->head->next == NULL;
+        pthread_mutex_unlock(&mem_mutex);
+    }
+    test_log("Completion service frees every process", all_freed);
+
+    stop_completion_service(service);
+    free_memory(mem);
+}
+
+void test_simulator() {
+    struct stats* stat = get_empty_stats();
+    run_event_driven(1000, 200, 10, 10, 5, NULL, BEST_FIT, NULL, 10, 10, 1, NULL, NULL, SCHEDULE_FIFO, NULL, NULL, stat);
+    test_log("Event-driven simulation", stat->turnaround_time_den > 0 && stat->memory_utilization_den >= stat->turnaround_time_den);
+    test_log("Turnaround includes the queue wait and the duration", get_histogram_count(&stat->turnaround_time) == stat->turnaround_time_den && get_histogram_percentile(&stat->turnaround_time, 1) >= 5000 && get_histogram_max(&stat->queue_wait_time) < get_histogram_max(&stat->turnaround_time));
+
+    struct stats* merged = get_empty_stats();
+    merge_stats(merged, stat);
+    merge_stats(merged, stat);
+    test_log("Stats merge across runs", merged->turnaround_time_den == 2 * stat->turnaround_time_den && get_histogram_count(&merged->turnaround_time) == 2 * stat->turnaround_time_den && get_histogram_percentile(&merged->queue_wait_time, 90) == get_histogram_percentile(&stat->queue_wait_time, 90));
+    free(merged);
+
+    struct stats* backfilled = get_empty_stats();
+    struct backfill_scheduler* backfill = get_new_backfill_scheduler(BACKFILL_FIRST, DEFAULT_BACKFILL_LIMIT);
+    run_event_driven(1000, 200, 10, 10, 5, NULL, BEST_FIT, NULL, 10, 10, 1, NULL, NULL, SCHEDULE_FIFO, backfill, NULL, backfilled);
+    test_log("Event-driven simulation with backfill", backfilled->turnaround_time_den > 0 && backfill->indexed - backfill->dequeued <= 10);
+    free_backfill_scheduler(backfill);
+    free(backfilled);
+
+    struct stats* bitmapped = get_empty_stats();
+    run_event_driven(1000, 200, 10, 10, 5, NULL, BITMAP_NEXT_FIT, NULL, 10, 10, 1, NULL, NULL, SCHEDULE_FIFO, NULL, NULL, bitmapped);
+    test_log("Event-driven simulation over a bitmap memory", bitmapped->turnaround_time_den > 0 && bitmapped->memory_utilization_den >= bitmapped->turnaround_time_den);
+    free(bitmapped);
+
+    struct stats* bursty = get_empty_stats();
+    struct arrival_model* model = get_new_arrival_model(ARRIVALS_BURSTY, 3, DEFAULT_MMPP_PEAK_FACTOR, DEFAULT_MMPP_DWELL_IN_MILLIS);
+    run_event_driven(1000, 200, 10, 10, 5, model, BEST_FIT, NULL, 10, 10, 1, NULL, NULL, SCHEDULE_FIFO, NULL, NULL, bursty);
+    test_log("Event-driven simulation with bursty arrivals", bursty->turnaround_time_den > 0);
+    free(model);
+    free(bursty);
+    free(stat);
 }
 
 int main(int argc, char** argv) {
     mute_logs();
     print_test_section("Testing data structures");
     test_ds();
+    print_test_section("Testing logger");
+    test_logger();
+    print_test_section("Testing simulator");
+    test_completion_service();
+    test_simulator();
+    test_trace();
+    test_thread_pool();
+    test_sweep();
     printf("\n%d/%d tests passed\n", passed_tests, total_tests);
     return 0;
 }
\ No newline at end of file
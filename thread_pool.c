@@ -0,0 +1,172 @@
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define INITIAL_TASK_DEQUE_CAPACITY (64)
+
+struct worker_args {
+    struct thread_pool* pool;
+    int id;
+};
+
+static __thread struct thread_pool* current_pool = NULL;
+static __thread int current_worker_id = -1;
+
+void init_task_deque(struct task_deque* deque) {
+    deque->capacity = INITIAL_TASK_DEQUE_CAPACITY;
+    deque->tasks = (struct task*)malloc(deque->capacity * sizeof(struct task));
+    deque->head = 0;
+    deque->tail = 0;
+    pthread_mutex_init(&deque->mutex, NULL);
+}
+
+void push_task(struct task_deque* deque, struct task task) {
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->tail == deque->capacity) {
+        int size = deque->tail - deque->head;
+        if (deque->head > 0) {
+            for (int i = 0; i < size; i++)
+                deque->tasks[i] = deque->tasks[deque->head + i];
+        }
+        if (size * 2 > deque->capacity) {
+            deque->capacity *= 2;
+            deque->tasks = (struct task*)realloc(deque->tasks, deque->capacity * sizeof(struct task));
+        }
+        deque->head = 0;
+        deque->tail = size;
+    }
+    deque->tasks[deque->tail++] = task;
+    pthread_mutex_unlock(&deque->mutex);
+}
+
+bool pop_task(struct task_deque* deque, struct task* task) {
+    pthread_mutex_lock(&deque->mutex);
+    bool found = deque->head < deque->tail;
+    if (found)
+        *task = deque->tasks[--deque->tail];
+    pthread_mutex_unlock(&deque->mutex);
+    return found;
+}
+
+bool steal_task(struct task_deque* deque, struct task* task) {
+    pthread_mutex_lock(&deque->mutex);
+    bool found = deque->head < deque->tail;
+    if (found)
+        *task = deque->tasks[deque->head++];
+    pthread_mutex_unlock(&deque->mutex);
+    return found;
+}
+
+/*
+Takes a task from the worker's own deque, else steals from the others starting at its neighbour
+*/
+bool take_task(struct thread_pool* pool, int id, struct task* task) {
+    if (pop_task(&pool->deques[id], task))
+        return true;
+    for (int i = 1; i < pool->num_workers; i++) {
+        if (steal_task(&pool->deques[(id + i) % pool->num_workers], task))
+            return true;
+    }
+    return false;
+}
+
+void* run_worker(void* args) {
+    struct worker_args* _args = (struct worker_args*)args;
+    struct thread_pool* pool = _args->pool;
+    int id = _args->id;
+    free(_args);
+    current_pool = pool;
+    current_worker_id = id;
+
+    while (true) {
+        struct task task;
+        if (take_task(pool, id, &task)) {
+            atomic_fetch_sub(&pool->queued, 1);
+            task.run(task.arg);
+            pthread_mutex_lock(&pool->mutex);
+            pool->pending -= 1;
+            if (pool->pending == 0)
+                pthread_cond_broadcast(&pool->idle);
+            pthread_mutex_unlock(&pool->mutex);
+            continue;
+        }
+        pthread_mutex_lock(&pool->mutex);
+        while (atomic_load(&pool->queued) == 0 && !pool->stopped)
+            pthread_cond_wait(&pool->changed, &pool->mutex);
+        bool stopped = pool->stopped && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->mutex);
+        if (stopped) break;
+    }
+    return NULL;
+}
+
+struct thread_pool* get_new_thread_pool(int num_workers) {
+    struct thread_pool* pool = (struct thread_pool*)malloc(sizeof(struct thread_pool));
+    pool->num_workers = num_workers > 0 ? num_workers : 1;
+    pool->deques = (struct task_deque*)malloc(pool->num_workers * sizeof(struct task_deque));
+    for (int i = 0; i < pool->num_workers; i++)
+        init_task_deque(&pool->deques[i]);
+    atomic_init(&pool->queued, 0);
+    pool->pending = 0;
+    pool->next_deque = 0;
+    pool->stopped = false;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->changed, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    pool->threads = (pthread_t*)malloc(pool->num_workers * sizeof(pthread_t));
+    for (int i = 0; i < pool->num_workers; i++) {
+        struct worker_args* args = (struct worker_args*)malloc(sizeof(struct worker_args));
+        args->pool = pool;
+        args->id = i;
+        pthread_create(&pool->threads[i], NULL, run_worker, args);
+    }
+    return pool;
+}
+
+void submit_task(struct thread_pool* pool, void (*run)(void* arg), void* arg) {
+    struct task task = {run, arg};
+    pthread_mutex_lock(&pool->mutex);
+    pool->pending += 1;
+    int id = current_worker_id;
+    if (current_pool != pool) {
+        id = pool->next_deque;
+        pool->next_deque = (pool->next_deque + 1) % pool->num_workers;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    atomic_fetch_add(&pool->queued, 1);  // Before the push, so a worker taking the task never sees `queued` below 0
+    push_task(&pool->deques[id], task);
+
+    pthread_mutex_lock(&pool->mutex);  // Workers check `queued` under the mutex before waiting, so the wakeup is not lost
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void wait_for_tasks(struct thread_pool* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->idle, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void free_thread_pool(struct thread_pool* pool) {
+    wait_for_tasks(pool);
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopped = true;
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_join(pool->threads[i], NULL);
+        free(pool->deques[i].tasks);
+        pthread_mutex_destroy(&pool->deques[i].mutex);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->changed);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->threads);
+    free(pool->deques);
+    free(pool);
+}
@@ -0,0 +1,58 @@
+#ifndef CS303_THREAD_POOL_H
+#define CS303_THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+struct task {
+    void (*run)(void* arg);
+    void* arg;
+};
+
+/*
+Growable deque of tasks, its owner pushes and pops at the tail, other workers steal from the head
+*/
+struct task_deque {
+    struct task* tasks;
+    int head;
+    int tail;
+    int capacity;
+    pthread_mutex_t mutex;
+};
+
+/*
+Fixed set of worker threads, each with its own task deque
+An idle worker steals the oldest task of another worker, so long tasks do not leave cores idle behind them
+*/
+struct thread_pool {
+    int num_workers;
+    struct task_deque* deques;
+    pthread_t* threads;
+    _Atomic int queued;      // Tasks submitted but not yet taken by a worker
+    int pending;             // Tasks submitted but not yet finished
+    int next_deque;          // Deque of the next task submitted from outside the pool
+    bool stopped;
+    pthread_mutex_t mutex;   // Guards `pending`, `next_deque` and `stopped`
+    pthread_cond_t changed;  // Signalled when a task is queued or the pool is stopped
+    pthread_cond_t idle;     // Signalled when `pending` drops to 0
+};
+
+struct thread_pool* get_new_thread_pool(int num_workers);
+
+/*
+Runs `run(arg)` on some worker
+Tasks submitted from a worker go to that worker's own deque, others are spread round robin
+*/
+void submit_task(struct thread_pool* pool, void (*run)(void* arg), void* arg);
+
+/*
+Blocks until every submitted task has finished
+*/
+void wait_for_tasks(struct thread_pool* pool);
+
+/*
+Waits for every submitted task, then stops and joins the workers
+*/
+void free_thread_pool(struct thread_pool* pool);
+
+#endif
@@ -0,0 +1,146 @@
+#include "trace.h"
+
+#include <endian.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+#define TRACE_MAP_PROTECTION (PROT_READ)
+#else
+#define TRACE_MAP_PROTECTION (PROT_READ | PROT_WRITE)  // Records are converted in place, the map is private
+#endif
+
+struct trace_writer* open_trace_writer(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) return NULL;
+    struct trace_header header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = htole32(TRACE_VERSION);
+    header.record_size = htole32(sizeof(struct trace_record));
+    fwrite(&header, sizeof(header), 1, file);
+
+    struct trace_writer* writer = (struct trace_writer*)malloc(sizeof(struct trace_writer));
+    writer->file = file;
+    writer->records = 0;
+    pthread_mutex_init(&writer->mutex, NULL);
+    return writer;
+}
+
+void write_trace_record(struct trace_writer* writer, long arrival_offset_in_millis, uint64_t size, int duration) {
+    struct trace_record record;
+    record.arrival_offset_in_millis = htole64(arrival_offset_in_millis);
+    record.size = htole64(size);
+    record.duration = htole32(duration);
+    record.reserved = 0;
+    pthread_mutex_lock(&writer->mutex);
+    if (writer->file != NULL) {
+        fwrite(&record, sizeof(record), 1, writer->file);
+        writer->records += 1;
+    }
+    pthread_mutex_unlock(&writer->mutex);
+}
+
+void close_trace_writer(struct trace_writer* writer) {
+    pthread_mutex_lock(&writer->mutex);
+    if (writer->file != NULL) {
+        fclose(writer->file);
+        writer->file = NULL;
+    }
+    pthread_mutex_unlock(&writer->mutex);
+}
+
+void free_trace_writer(struct trace_writer* writer) {
+    close_trace_writer(writer);
+    pthread_mutex_destroy(&writer->mutex);
+    free(writer);
+}
+
+struct trace_reader* open_trace_reader(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || (size_t)file_stat.st_size < sizeof(struct trace_header)) {
+        close(fd);
+        return NULL;
+    }
+    size_t map_size = file_stat.st_size;
+    void* map = mmap(NULL, map_size, TRACE_MAP_PROTECTION, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    const struct trace_header* header = (const struct trace_header*)map;
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 || le32toh(header->version) != TRACE_VERSION || le32toh(header->record_size) != sizeof(struct trace_record)) {
+        munmap(map, map_size);
+        close(fd);
+        return NULL;
+    }
+    madvise(map, map_size, MADV_SEQUENTIAL);
+
+    struct trace_reader* reader = (struct trace_reader*)malloc(sizeof(struct trace_reader));
+    reader->fd = fd;
+    reader->map = map;
+    reader->map_size = map_size;
+    reader->records = (const struct trace_record*)((const char*)map + sizeof(struct trace_header));
+    reader->num_records = (map_size - sizeof(struct trace_header)) / sizeof(struct trace_record);
+    reader->next = 0;
+    reader->num_loaded_records = 0;
+    reader->released_size = 0;
+    return reader;
+}
+
+/*
+Converts the next record to host byte order the first time it is reached, a no-op on little-endian hosts
+*/
+void load_next_trace_record(struct trace_reader* reader) {
+#if __BYTE_ORDER != __LITTLE_ENDIAN
+    if (reader->next < reader->num_loaded_records) return;
+    struct trace_record* record = (struct trace_record*)&reader->records[reader->next];
+    record->arrival_offset_in_millis = le64toh(record->arrival_offset_in_millis);
+    record->size = le64toh(record->size);
+    record->duration = le32toh(record->duration);
+    reader->num_loaded_records = reader->next + 1;
+#else
+    (void)reader;
+#endif
+}
+
+const struct trace_record* peek_trace_record(struct trace_reader* reader) {
+    if (reader->next >= reader->num_records) return NULL;
+    load_next_trace_record(reader);
+    return &reader->records[reader->next];
+}
+
+/*
+Hands the pages before the previous record back to the kernel once a whole chunk has been replayed
+*/
+void release_replayed_pages(struct trace_reader* reader) {
+    size_t replayed_size = (const char*)&reader->records[reader->next - 1] - (const char*)reader->map;
+    if (replayed_size - reader->released_size < TRACE_RELEASE_CHUNK_SIZE) return;
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t release_end = replayed_size / page_size * page_size;
+    madvise((char*)reader->map + reader->released_size, release_end - reader->released_size, MADV_DONTNEED);
+    reader->released_size = release_end;
+}
+
+const struct trace_record* next_trace_record(struct trace_reader* reader) {
+    if (reader->next >= reader->num_records) return NULL;
+    load_next_trace_record(reader);
+    reader->next += 1;
+    release_replayed_pages(reader);
+    return &reader->records[reader->next - 1];
+}
+
+void close_trace_reader(struct trace_reader* reader) {
+    munmap(reader->map, reader->map_size);
+    close(reader->fd);
+    free(reader);
+}
@@ -0,0 +1,85 @@
+#ifndef CS303_TRACE_H
+#define CS303_TRACE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRACE_MAGIC "CS303TRC"
+#define TRACE_VERSION (2)  // Version 1 recorded sizes in MBs
+#define TRACE_RELEASE_CHUNK_SIZE (64L << 20)  // Replayed pages are released to the kernel in chunks of this many bytes
+
+/*
+A trace file is a trace_header followed by packed trace_records in arrival order, all little-endian
+Big-endian hosts swap each record in place within their private map of the trace, see open_trace_reader()
+*/
+struct trace_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+struct trace_record {
+    uint64_t arrival_offset_in_millis;  // Since the start of the simulation
+    uint64_t size;                      // Bytes
+    uint32_t duration;                  // Seconds
+    uint32_t reserved;                  // Zero, keeps records 8 byte aligned
+};
+
+struct trace_writer {
+    FILE* file;
+    long records;
+    pthread_mutex_t mutex;  // A simulation may still be recording while the trace is closed
+};
+
+/*
+Replays a trace straight from a read-only memory map, records are never copied
+Pages behind the replay position are released, so traces larger than the memory can be streamed
+*/
+struct trace_reader {
+    int fd;
+    void* map;
+    size_t map_size;
+    const struct trace_record* records;
+    long num_records;
+    long next;
+    long num_loaded_records;  // Records already converted to host byte order
+    size_t released_size;  // Bytes from the start of `map` already handed back to the kernel
+};
+
+/*
+Returns NULL if `path` can not be created
+*/
+struct trace_writer* open_trace_writer(const char* path);
+
+void write_trace_record(struct trace_writer* writer, long arrival_offset_in_millis, uint64_t size, int duration);
+
+/*
+Flushes and closes the trace, later writes are ignored
+*/
+void close_trace_writer(struct trace_writer* writer);
+
+void free_trace_writer(struct trace_writer* writer);
+
+/*
+Returns NULL if `path` can not be mapped or is not a trace of the current version
+*/
+struct trace_reader* open_trace_reader(const char* path);
+
+/*
+Returns the next record without consuming it
+        NULL if the trace is over
+*/
+const struct trace_record* peek_trace_record(struct trace_reader* reader);
+
+/*
+Returns the next record, which stays valid until the following call
+        NULL if the trace is over
+*/
+const struct trace_record* next_trace_record(struct trace_reader* reader);
+
+void close_trace_reader(struct trace_reader* reader);
+
+#endif